@@ -0,0 +1,161 @@
+// ----- SD THROUGHPUT BENCHMARK -----
+// Compares how the log used to be written (card mounted at the 4 MHz
+// default, open + header read + write + close for every append) with the
+// block writer in storage.cpp, at several SPI clocks.
+//
+//   pio run -e sdbench -t upload && pio device monitor
+//   pio run -e native_sdbench && .pio/build/native_sdbench/program --cycles 1
+//
+// "appends/s" appends BENCH_APPENDS records one at a time, each made
+// durable before the next. "ms/cycle" repeats a wake's SD work
+// BENCH_CYCLES times: mount, append RTC_FLUSH_EVERY records, flush. The old
+// code mounted twice per uplink wake (network phase and logging). The
+// native numbers come from the mock's SPI cost model; only a board gives
+// real ones. Scratch files are /bench_*.bin.
+
+#include "config.h"
+#include "globals.h"
+#include "record.h"
+#include "storage.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <SPI.h>
+#include <esp_sleep.h>
+
+static const uint16_t BENCH_APPENDS = 200;
+static const uint16_t BENCH_CYCLES = 20;
+static const uint32_t BENCH_CLOCKS_HZ[] = {4000000, 10000000, 20000000,
+                                           40000000};
+static const char *const LEGACY_FILE = "/bench_legacy.bin";
+static const char *const WRITER_FILE = "/bench_writer.bin";
+
+static LogRecord batch[RTC_FLUSH_EVERY];
+
+// appendRecords() as it was before the block writer
+static bool legacyAppend(const char *filename, const LogRecord *recs,
+                         size_t n) {
+  uint32_t count = 0;
+  File file = SD.open(filename, "r+");
+  if (file) {
+    LogHeader hdr;
+    if (file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+        !logHeaderValid(hdr)) {
+      file.close();
+      return false;
+    }
+    count = (file.size() - LOG_HEADER_SIZE) / LOG_RECORD_SIZE;
+    file.seek(LOG_HEADER_SIZE + count * LOG_RECORD_SIZE);
+  } else {
+    file = SD.open(filename, FILE_WRITE);
+    if (!file)
+      return false;
+    LogHeader hdr;
+    initLogHeader(hdr, recs[0].ts);
+    file.write((const uint8_t *)&hdr, sizeof(hdr));
+  }
+
+  const size_t perBlock = LOG_BLOCK_SIZE / LOG_RECORD_SIZE;
+  size_t written = 0;
+  while (written < n) {
+    size_t chunk = min(n - written, perBlock - (count + written) % perBlock);
+    size_t bytes = chunk * LOG_RECORD_SIZE;
+    if (file.write((const uint8_t *)(recs + written), bytes) != bytes)
+      break;
+    written += chunk;
+  }
+  file.close();
+  return written == n;
+}
+
+static bool writerAppend(const char *filename, const LogRecord *recs,
+                         size_t n) {
+  return appendRecords(filename, recs, n) && flushLog();
+}
+
+typedef bool (*AppendFn)(const char *, const LogRecord *, size_t);
+
+// Returns appends per second, 0 if the card failed
+static float benchAppends(AppendFn append, const char *filename) {
+  SD.remove(filename);
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < BENCH_APPENDS; i++) {
+    if (!append(filename, &batch[i % RTC_FLUSH_EVERY], 1))
+      return 0;
+  }
+  closeLog();
+  return BENCH_APPENDS * 1e6f / (micros() - start);
+}
+
+// Returns ms per wake, 0 if the card failed
+static float benchCycles(AppendFn append, const char *filename, uint32_t hz,
+                         uint8_t mounts) {
+  SD.remove(filename);
+  SD.end();
+  uint32_t start = micros();
+  for (uint16_t c = 0; c < BENCH_CYCLES; c++) {
+    for (uint8_t m = 0; m < mounts; m++) {
+      if (!SD.begin(SD_CS, SPI, hz))
+        return 0;
+    }
+    bool ok = append(filename, batch, RTC_FLUSH_EVERY);
+    closeLog();
+    SD.end();
+    if (!ok)
+      return 0;
+  }
+  float ms = (micros() - start) / 1000.0f / BENCH_CYCLES;
+  SD.begin(SD_CS, SPI, hz);
+  return ms;
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println(F("\n===== SD BENCHMARK ====="));
+  for (uint16_t i = 0; i < RTC_FLUSH_EVERY; i++) {
+    struct tm t = {};
+    t.tm_year = 125;
+    t.tm_mday = 1;
+    t.tm_min = i * 30;
+    LogRecord &rec = batch[i];
+    beginRecord(rec);
+    rec.temp = 22.5f;
+    rec.hum = 55.0f;
+    rec.pm1 = 8;
+    rec.pm25 = 12;
+    rec.pm10 = 15;
+    rec.vin = 12.1f;
+    rec.battery = 3.9f;
+    finishRecord(rec, (uint32_t)mktime(&t));
+  }
+
+  // the old code ran at the library default clock
+  float legacyRate = 0, legacyCycle = 0;
+  if (SD.begin(SD_CS)) {
+    legacyRate = benchAppends(legacyAppend, LEGACY_FILE);
+    legacyCycle = benchCycles(legacyAppend, LEGACY_FILE, 4000000, 2);
+    SD.remove(LEGACY_FILE);
+  }
+  Serial.printf("legacy  @  4 MHz: %7.1f appends/s %7.2f ms/cycle\n",
+                legacyRate, legacyCycle);
+
+  for (uint32_t hz : BENCH_CLOCKS_HZ) {
+    SD.end();
+    if (!SD.begin(SD_CS, SPI, hz)) {
+      Serial.printf("writer  @ %2u MHz: card did not mount\n",
+                    (unsigned)(hz / 1000000));
+      continue;
+    }
+    float rate = benchAppends(writerAppend, WRITER_FILE);
+    float cycle = benchCycles(writerAppend, WRITER_FILE, hz, 1);
+    SD.remove(WRITER_FILE);
+    Serial.printf("writer  @ %2u MHz: %7.1f appends/s %7.2f ms/cycle\n",
+                  (unsigned)(hz / 1000000), rate, cycle);
+  }
+
+  SD.end();
+  Serial.println(F("========================"));
+  Serial.flush();
+  esp_deep_sleep_start();
+}
+
+void loop() {}
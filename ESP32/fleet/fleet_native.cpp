@@ -0,0 +1,462 @@
+// ----- FLEET LOAD GENERATOR -----
+// Runs the unmodified firmware for N simulated units against one ingest
+// server, to see what the backend gets when the whole fleet wakes on the
+// same half-hour slots and drains its backlogs at once.
+//
+//   python tools/ingest_stub.py --quiet &
+//   pio run -e native_fleet
+//   .pio/build/native_fleet/program --devices 200 --hours 48 --outage 12+6@0.5
+//
+// Each unit has its own state directory (RTC memory, SD card, NVS,
+// DS3231) under --state, which is cleared at start. As in the single-unit
+// runner (native/main_native.cpp) every wake is a fork()ed process: the
+// firmware keeps its state in globals, so a process per wake stands in
+// for a device where threads could not.
+//
+// Time is simulated. Wakes that boot within --window seconds of each other
+// run as one wave, up to --parallel processes at once, so the server sees
+// their requests concurrently in real time. Request rates are reported in
+// simulated time (what the backend would see from the real fleet);
+// latencies are the real ones against the local server under that load.
+//
+// Options:
+//   --devices N       simulated units (10)
+//   --hours H         simulated duration (24)
+//   --stagger S       first boots spread over S seconds (1800)
+//   --skew S          DS3231 error at first power-up, uniform ±S seconds (120)
+//   --drift PPM       DS3231 drift, uniform ±PPM (20)
+//   --timer-ppm PPM   deep-sleep timer error, uniform ±PPM (1000)
+//   --outage H+D[@F]  a fraction F (default all) of the units has no WiFi
+//                     from hour H for D hours; repeatable
+//   --flaky P         chance that any one wake finds no WiFi (0)
+//   --window S        wave width in simulated seconds (60)
+//   --parallel P      wake processes in flight (32)
+//   --seed N          unit parameters and flaky wakes (1)
+//   --state DIR       fleet_state
+//   --server HOST:PORT
+//   --verbose         firmware output to the terminal instead of each
+//                     unit's console.log
+
+#include "rtcbuffer.h"
+#include "sim.h"
+#include <Arduino.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+void setup();
+void loop();
+
+struct Unit {
+  uint32_t id;
+  std::string dir;
+  uint64_t bootWallUs; // next wake, simulated UTC
+  uint64_t lastBootUs; // of the wake that just ended
+  uint64_t lastEndUs;
+  uint32_t cycle;
+  uint32_t backlog;    // records not uploaded yet, after the last wake
+  float rtcDriftPpm;
+  float sleepTimerPpm;
+  int rtcOffsetS;
+  std::vector<bool> inOutage; // per --outage
+  std::vector<bool> drained;  // per --outage, backlog gone since it ended
+  bool wifi;                  // of the wake in flight
+  bool dead;                  // a wake crashed; no more wakes
+};
+
+struct Outage {
+  uint64_t startUs, endUs; // simulated UTC
+  float fraction;
+  std::vector<double> drainS; // per member, outage end to empty backlog
+  uint32_t members;
+  uint32_t peakBacklog;
+};
+
+struct FleetStats {
+  uint32_t wakes = 0;
+  uint32_t crashes = 0;
+  uint32_t waves = 0;
+  uint32_t largestWave = 0;
+  uint64_t awakeUs = 0;
+  uint32_t peakBacklog = 0; // sum over the fleet after a wave
+  uint64_t peakBacklogUs = 0;
+};
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--devices N] [--hours H] [--stagger S] [--skew S]\n"
+          "          [--drift PPM] [--timer-ppm PPM] [--outage H+D[@F]]...\n"
+          "          [--flaky P] [--window S] [--parallel P] [--seed N]\n"
+          "          [--state DIR] [--server HOST:PORT] [--verbose]\n",
+          argv0);
+  exit(2);
+}
+
+static std::string formatWall(uint64_t us) {
+  time_t t = us / 1000000;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char buf[32];
+  strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+  return buf;
+}
+
+static double percentile(std::vector<double> v, double p) {
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(p * v.size() + 0.999999);
+  return v[std::min(v.size(), std::max<size_t>(i, 1)) - 1];
+}
+
+// Child side of one wake; never returns
+static void runWake(const Unit &u, bool verbose) {
+  if (!verbose && !freopen((u.dir + "/console.log").c_str(), "a", stdout))
+    _exit(4);
+  sim::setCycleIndex(u.cycle);
+  sim::setBootWallClockUs(u.bootWallUs);
+  sim::loadRtcMemory(u.dir + "/rtc_memory.bin");
+  setup();
+  for (int i = 0; i < 1000; i++)
+    loop();
+  fprintf(stderr, "unit %u: cycle %u never went to deep sleep\n", u.id, u.cycle);
+  _exit(3);
+}
+
+// Records still to upload as of the unit's last wake, read from the RTC
+// memory it left behind (the same figure the firmware's uplink policy uses)
+static uint32_t unitBacklog(const Unit &u) {
+  if (!sim::loadRtcMemory(u.dir + "/rtc_memory.bin"))
+    return 0;
+  return rtcBufferSdPending() + rtcBufferCount();
+}
+
+// Parent side once a wake has exited: move the unit on to its next wake
+static bool finishWake(Unit &u, int status, FleetStats &stats) {
+  uint64_t slept[3] = {0, 0, 0}; // awake us, sleep us, heap allocations
+  FILE *f = fopen((u.dir + "/sleep.bin").c_str(), "rb");
+  bool ok = f && fread(slept, sizeof(slept), 1, f) == 1;
+  if (f)
+    fclose(f);
+  if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "unit %u: cycle %u crashed (status 0x%x), see %s/console.log\n",
+            u.id, u.cycle, status, u.dir.c_str());
+    u.dead = true;
+    stats.crashes++;
+    return false;
+  }
+  stats.wakes++;
+  stats.awakeUs += slept[0];
+  u.lastBootUs = u.bootWallUs;
+  u.lastEndUs = u.bootWallUs + slept[0];
+  u.bootWallUs += slept[0] + (uint64_t)(slept[1] * (1.0 + u.sleepTimerPpm / 1e6));
+  u.cycle++;
+  return true;
+}
+
+// ----- REPORT -----
+static void reportRequests(const std::string &path, double hours) {
+  std::vector<sim::RequestSample> samples;
+  FILE *f = fopen(path.c_str(), "rb");
+  sim::RequestSample r;
+  while (f && fread(&r, sizeof(r), 1, f) == 1)
+    samples.push_back(r);
+  if (f)
+    fclose(f);
+  if (samples.empty()) {
+    printf("\nNo HTTP requests were made.\n");
+    return;
+  }
+
+  struct Endpoint {
+    uint32_t requests = 0, errors = 0, connects = 0;
+    uint64_t sent = 0;
+    std::vector<double> latencyMs;
+  };
+  std::map<std::string, Endpoint> endpoints;
+  std::map<uint64_t, uint32_t> perSecond, perMinute;
+  std::map<uint64_t, uint64_t> bytesPerMinute;
+  for (const sim::RequestSample &s : samples) {
+    Endpoint &e = endpoints[std::string(s.path, strnlen(s.path, sizeof(s.path)))];
+    e.requests++;
+    e.errors += s.code < 200 || s.code >= 300;
+    e.connects += s.connects;
+    e.sent += s.sentBytes;
+    e.latencyMs.push_back(s.realUs / 1000.0);
+    perSecond[s.wallUs / 1000000]++;
+    perMinute[s.wallUs / 60000000]++;
+    bytesPerMinute[s.wallUs / 60000000] += s.sentBytes;
+  }
+
+  printf("\n%-32s %7s %6s %6s %9s %7s %7s %7s %7s %7s\n", "endpoint", "reqs",
+         "errors", "conns", "sent KB", "avg B", "p50 ms", "p95 ms", "p99 ms",
+         "max ms");
+  for (const auto &kv : endpoints) {
+    const Endpoint &e = kv.second;
+    printf("%-32s %7u %6u %6u %9.1f %7.0f %7.1f %7.1f %7.1f %7.1f\n",
+           kv.first.c_str(), e.requests, e.errors, e.connects, e.sent / 1024.0,
+           (double)e.sent / e.requests, percentile(e.latencyMs, 0.50),
+           percentile(e.latencyMs, 0.95), percentile(e.latencyMs, 0.99),
+           percentile(e.latencyMs, 1.0));
+  }
+
+  auto peak = [](const std::map<uint64_t, uint32_t> &m) {
+    return *std::max_element(m.begin(), m.end(), [](const std::pair<const uint64_t, uint32_t> &a,
+                                                     const std::pair<const uint64_t, uint32_t> &b) {
+      return a.second < b.second;
+    });
+  };
+  auto sec = peak(perSecond);
+  auto min = peak(perMinute);
+  uint64_t peakBytes = 0;
+  for (const auto &kv : bytesPerMinute)
+    peakBytes = std::max(peakBytes, kv.second);
+  uint64_t totalSent = 0;
+  for (const auto &kv : endpoints)
+    totalSent += kv.second.sent;
+  printf("\nRequests (simulated time): %zu in %.1f h, mean %.2f/min, "
+         "peak %u/min at %s, peak %u/s at %s\n",
+         samples.size(), hours, samples.size() / (hours * 60), min.second,
+         formatWall(min.first * 60000000).c_str(), sec.second,
+         formatWall(sec.first * 1000000).c_str());
+  printf("Payload: %.1f KB sent, mean %.0f B/request, peak %.1f KB/min\n",
+         totalSent / 1024.0, (double)totalSent / samples.size(), peakBytes / 1024.0);
+}
+
+int main(int argc, char **argv) {
+  sim::Scenario &sc = sim::scenario();
+  uint32_t devices = 10, parallel = 32, seed = 1;
+  double hours = 24, staggerS = 1800, skewS = 120, driftPpm = 20, timerPpm = 1000;
+  double flaky = 0, windowS = 60;
+  bool verbose = false;
+  std::string stateDir = "fleet_state";
+  std::vector<Outage> outages;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!hasValue && a != "--verbose")
+      usage(argv[0]);
+    if (a == "--devices") {
+      devices = strtoul(argv[++i], nullptr, 10);
+    } else if (a == "--hours") {
+      hours = atof(argv[++i]);
+    } else if (a == "--stagger") {
+      staggerS = atof(argv[++i]);
+    } else if (a == "--skew") {
+      skewS = atof(argv[++i]);
+    } else if (a == "--drift") {
+      driftPpm = atof(argv[++i]);
+    } else if (a == "--timer-ppm") {
+      timerPpm = atof(argv[++i]);
+    } else if (a == "--outage") {
+      float h = 0, d = 0, frac = 1;
+      if (sscanf(argv[++i], "%f+%f@%f", &h, &d, &frac) < 2 || d <= 0)
+        usage(argv[0]);
+      Outage o = {};
+      o.startUs = (uint64_t)(h * 3600e6);
+      o.endUs = (uint64_t)((h + d) * 3600e6);
+      o.fraction = frac;
+      outages.push_back(o);
+    } else if (a == "--flaky") {
+      flaky = atof(argv[++i]);
+    } else if (a == "--window") {
+      windowS = atof(argv[++i]);
+    } else if (a == "--parallel") {
+      parallel = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+    } else if (a == "--seed") {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if (a == "--state") {
+      stateDir = argv[++i];
+    } else if (a == "--server") {
+      std::string hp = argv[++i];
+      size_t colon = hp.find(':');
+      sc.serverHost = hp.substr(0, colon);
+      if (colon != std::string::npos)
+        sc.serverPort = atoi(hp.c_str() + colon + 1);
+    } else if (a == "--verbose") {
+      verbose = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (!devices)
+    usage(argv[0]);
+
+  // The ESP32 starts in UTC until configTime() sets a zone
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  std::string cmd = "rm -rf '" + stateDir + "'";
+  if (system(cmd.c_str()) != 0)
+    return 1;
+  mkdir(stateDir.c_str(), 0755);
+  sc.requestLog = stateDir + "/requests.bin";
+
+  // Outages are given in hours from the start of the run
+  uint64_t startUs = (uint64_t)time(nullptr) * 1000000;
+  uint64_t endUs = startUs + (uint64_t)(hours * 3600e6);
+  for (Outage &o : outages) {
+    o.startUs += startUs;
+    o.endUs += startUs;
+  }
+
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  auto spread = [&](double range) { return (uniform(rng) * 2 - 1) * range; };
+
+  // A unit's first wake starts from the firmware's initial RTC memory,
+  // which this process' copy is about to stop being
+  std::string pristine = stateDir + "/rtc_initial.bin";
+  sim::saveRtcMemory(pristine);
+
+  std::vector<Unit> units(devices);
+  for (uint32_t i = 0; i < devices; i++) {
+    Unit &u = units[i];
+    char name[16];
+    snprintf(name, sizeof(name), "/dev%04u", i);
+    u.id = i;
+    u.dir = stateDir + name;
+    mkdir(u.dir.c_str(), 0755);
+    sim::loadRtcMemory(pristine);
+    sim::saveRtcMemory(u.dir + "/rtc_memory.bin");
+    u.bootWallUs = startUs + (uint64_t)(uniform(rng) * staggerS * 1e6);
+    u.lastBootUs = u.lastEndUs = 0;
+    u.cycle = 0;
+    u.backlog = 0;
+    u.rtcDriftPpm = spread(driftPpm);
+    u.sleepTimerPpm = spread(timerPpm);
+    u.rtcOffsetS = (int)lround(spread(skewS));
+    for (Outage &o : outages) {
+      bool member = uniform(rng) < o.fraction;
+      u.inOutage.push_back(member);
+      u.drained.push_back(false);
+      o.members += member;
+    }
+    u.wifi = true;
+    u.dead = false;
+  }
+
+  printf("Fleet: %u unit(s) over %.1f h from %s UTC, %zu outage(s), "
+         "state in %s/\n",
+         devices, hours, formatWall(startUs).c_str(), outages.size(),
+         stateDir.c_str());
+  fflush(stdout);
+
+  FleetStats stats;
+  timespec realStart, realEnd;
+  clock_gettime(CLOCK_MONOTONIC, &realStart);
+
+  while (true) {
+    // ----- NEXT WAVE -----
+    uint64_t first = UINT64_MAX;
+    for (const Unit &u : units)
+      if (!u.dead)
+        first = std::min(first, u.bootWallUs);
+    if (first >= endUs)
+      break;
+    uint64_t waveEnd = std::min(endUs, first + (uint64_t)(windowS * 1e6));
+    std::vector<Unit *> wave;
+    for (Unit &u : units)
+      if (!u.dead && u.bootWallUs < waveEnd)
+        wave.push_back(&u);
+    std::sort(wave.begin(), wave.end(),
+              [](const Unit *a, const Unit *b) { return a->bootWallUs < b->bootWallUs; });
+    stats.waves++;
+    stats.largestWave = std::max<uint32_t>(stats.largestWave, wave.size());
+
+    std::map<pid_t, Unit *> running;
+    auto reap = [&]() {
+      int status = 0;
+      pid_t pid = waitpid(-1, &status, 0);
+      if (pid <= 0)
+        return;
+      Unit *u = running[pid];
+      running.erase(pid);
+      finishWake(*u, status, stats);
+    };
+    for (Unit *u : wave) {
+      while (running.size() >= parallel)
+        reap();
+      bool offline = flaky > 0 && uniform(rng) < flaky;
+      for (size_t k = 0; k < outages.size(); k++)
+        offline |= u->inOutage[k] && u->bootWallUs >= outages[k].startUs &&
+                   u->bootWallUs < outages[k].endUs;
+      u->wifi = !offline;
+
+      sc.stateDir = u->dir;
+      sc.device = u->id;
+      sc.wifi = u->wifi;
+      sc.rtcDriftPpm = u->rtcDriftPpm;
+      sc.sleepTimerPpm = u->sleepTimerPpm;
+      sc.rtcOffsetS = u->rtcOffsetS;
+      unlink((u->dir + "/sleep.bin").c_str());
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("fork");
+        return 1;
+      }
+      if (pid == 0)
+        runWake(*u, verbose);
+      running[pid] = u;
+    }
+    while (!running.empty())
+      reap();
+
+    // ----- BACKLOG -----
+    for (Unit *u : wave) {
+      if (u->dead)
+        continue;
+      u->backlog = unitBacklog(*u);
+      for (size_t k = 0; k < outages.size(); k++) {
+        Outage &o = outages[k];
+        if (!u->inOutage[k] || u->drained[k] || u->lastBootUs < o.startUs)
+          continue;
+        o.peakBacklog = std::max(o.peakBacklog, u->backlog);
+        if (u->backlog == 0 && u->lastBootUs >= o.endUs) {
+          u->drained[k] = true;
+          o.drainS.push_back((u->lastEndUs - o.endUs) / 1e6);
+        }
+      }
+    }
+    uint32_t fleetBacklog = 0;
+    for (const Unit &u : units)
+      fleetBacklog += u.backlog;
+    if (fleetBacklog > stats.peakBacklog) {
+      stats.peakBacklog = fleetBacklog;
+      stats.peakBacklogUs = first;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &realEnd);
+  double realS = (realEnd.tv_sec - realStart.tv_sec) +
+                 (realEnd.tv_nsec - realStart.tv_nsec) / 1e9;
+
+  printf("\n===== FLEET REPORT =====\n");
+  printf("Wakes: %u (%.1f per unit-hour), %u crash(es), mean awake %.2f s\n",
+         stats.wakes, stats.wakes / (hours * devices), stats.crashes,
+         stats.wakes ? stats.awakeUs / 1e6 / stats.wakes : 0);
+  printf("Waves: %u, largest %u unit(s) within %.0f s, %.1f s real time\n",
+         stats.waves, stats.largestWave, windowS, realS);
+  reportRequests(sc.requestLog, hours);
+
+  printf("\nBacklog: fleet peak %u record(s) at %s UTC\n", stats.peakBacklog,
+         formatWall(stats.peakBacklogUs).c_str());
+  for (size_t k = 0; k < outages.size(); k++) {
+    const Outage &o = outages[k];
+    printf("Outage %zu (%s to %s UTC, %u unit(s)): peak %u record(s)/unit, "
+           "%zu drained, p50 %.0f min, p95 %.0f min, max %.0f min\n",
+           k + 1, formatWall(o.startUs).c_str(), formatWall(o.endUs).c_str(),
+           o.members, o.peakBacklog, o.drainS.size(),
+           percentile(o.drainS, 0.50) / 60, percentile(o.drainS, 0.95) / 60,
+           percentile(o.drainS, 1.0) / 60);
+    if (o.drainS.size() < o.members)
+      printf("  %zu unit(s) still had a backlog when the run ended\n",
+             o.members - o.drainS.size());
+  }
+  return stats.crashes ? 1 : 0;
+}
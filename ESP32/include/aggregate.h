@@ -0,0 +1,23 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "record.h"
+#include <Arduino.h>
+
+// ----- ON-DEVICE AGGREGATES -----
+// Running PM1/PM2.5/PM10 statistics for the current clock hour, the
+// current local day and the previous day, kept in RTC memory across deep
+// sleep: count, mean, min, max and an approximate p95 from a fixed
+// histogram. A ring of hourly sums gives a rolling 24-hour mean, from
+// which the US EPA and Nepal AQI are computed (see aqi.h).
+//
+// The summary goes out as "agg" in the upload meta, so a dashboard can
+// read it from the newest reading instead of averaging the raw series.
+// Readings without a clock or a PM value are not counted.
+
+void aggregateAdd(const LogRecord &rec);
+// Appends the summary as a JSON object; returns the length like snprintf
+int formatAggregates(char *buf, size_t size);
+void printAggregates();
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef AQI_H
+#define AQI_H
+
+#include <Arduino.h>
+
+// ----- AIR QUALITY INDEX -----
+// Piecewise-linear AQI from breakpoint tables, all constexpr so the tables
+// are checked and the functions can be evaluated at compile time:
+//
+//   I = (iHi - iLo) / (cHi - cLo) * (C - cLo) + iLo
+//
+// C is the averaged concentration in µg/m³, truncated to the table's
+// precision first (0.1 for PM2.5, 1 for PM10). Above the last breakpoint
+// the index is capped at the table's top value.
+
+struct AqiBreakpoint {
+  float cLo, cHi;
+  uint16_t iLo, iHi;
+};
+
+// US EPA, 24-hour PM2.5 (2024 revision) and PM10
+constexpr AqiBreakpoint AQI_US_PM25[] = {
+    {0.0f, 9.0f, 0, 50},       {9.1f, 35.4f, 51, 100},
+    {35.5f, 55.4f, 101, 150},  {55.5f, 125.4f, 151, 200},
+    {125.5f, 225.4f, 201, 300}, {225.5f, 325.4f, 301, 500}};
+constexpr AqiBreakpoint AQI_US_PM10[] = {
+    {0, 54, 0, 50},       {55, 154, 51, 100},   {155, 254, 101, 150},
+    {255, 354, 151, 200}, {355, 424, 201, 300}, {425, 604, 301, 500}};
+
+// Nepal AQI (Department of Environment), 24-hour PM2.5 and PM10
+constexpr AqiBreakpoint AQI_NP_PM25[] = {
+    {0.0f, 15.0f, 0, 50},       {15.1f, 40.0f, 51, 100},
+    {40.1f, 65.0f, 101, 150},   {65.1f, 150.0f, 151, 200},
+    {150.1f, 250.0f, 201, 300}, {250.1f, 500.0f, 301, 500}};
+constexpr AqiBreakpoint AQI_NP_PM10[] = {
+    {0, 50, 0, 50},       {51, 120, 51, 100},   {121, 350, 101, 150},
+    {351, 420, 151, 200}, {421, 500, 201, 300}, {501, 600, 301, 500}};
+
+// Written in C++11 constexpr style (single return, recursion) to build
+// with the ESP32 Arduino core's default language level.
+template <size_t N>
+constexpr bool aqiTableValid(const AqiBreakpoint (&t)[N], size_t i = 0) {
+  return i == N ||
+         (t[i].cLo < t[i].cHi && t[i].iLo < t[i].iHi &&
+          (i == 0 || (t[i].cLo > t[i - 1].cHi && t[i].iLo == t[i - 1].iHi + 1)) &&
+          aqiTableValid(t, i + 1));
+}
+
+constexpr float aqiTruncate(float c, float step) {
+  // the small bias keeps e.g. 35.4 / 0.1 from truncating to 353
+  return (float)(int32_t)(c / step + 1e-3f) * step;
+}
+
+template <size_t N>
+constexpr int aqiSegment(const AqiBreakpoint (&t)[N], float c, size_t i) {
+  return c >= t[N - 1].cHi ? t[N - 1].iHi
+         : i < N - 1 && c > t[i].cHi
+             ? aqiSegment(t, c, i + 1)
+             : (int)((t[i].iHi - t[i].iLo) * (c - t[i].cLo) /
+                         (t[i].cHi - t[i].cLo) +
+                     t[i].iLo + 0.5f);
+}
+
+// Returns -1 for a missing (negative or NaN) concentration
+template <size_t N>
+constexpr int aqiFromTable(const AqiBreakpoint (&t)[N], float c, float step) {
+  return !(c >= 0) ? -1 : aqiSegment(t, aqiTruncate(c, step), 0);
+}
+
+constexpr int aqiMax(int a, int b) { return a > b ? a : b; }
+
+// Overall index: the worse of the PM2.5 and PM10 sub-indices
+constexpr int aqiUs(float pm25, float pm10) {
+  return aqiMax(aqiFromTable(AQI_US_PM25, pm25, 0.1f),
+                aqiFromTable(AQI_US_PM10, pm10, 1.0f));
+}
+
+constexpr int aqiNepal(float pm25, float pm10) {
+  return aqiMax(aqiFromTable(AQI_NP_PM25, pm25, 0.1f),
+                aqiFromTable(AQI_NP_PM10, pm10, 1.0f));
+}
+
+static_assert(aqiTableValid(AQI_US_PM25) && aqiTableValid(AQI_US_PM10),
+              "US AQI breakpoints out of order");
+static_assert(aqiTableValid(AQI_NP_PM25) && aqiTableValid(AQI_NP_PM10),
+              "Nepal AQI breakpoints out of order");
+static_assert(aqiFromTable(AQI_US_PM25, 9.0f, 0.1f) == 50 &&
+                  aqiFromTable(AQI_US_PM25, 35.45f, 0.1f) == 100 &&
+                  aqiFromTable(AQI_US_PM25, 500.0f, 0.1f) == 500,
+              "US PM2.5 AQI");
+static_assert(aqiFromTable(AQI_US_PM10, 154.9f, 1.0f) == 100, "US PM10 AQI");
+
+#endif
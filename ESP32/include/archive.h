@@ -0,0 +1,105 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "record.h"
+#include <Arduino.h>
+
+// ----- COMPRESSED ARCHIVE FORMAT -----
+// Long-term copy of the master log, compressed in the style of Facebook's
+// Gorilla time-series codec. The file is a sequence of independent
+// ARCHIVE_BLOCK_SIZE blocks: a 32-byte ArchiveBlockHeader, then a
+// bitstream (MSB first) with header.count records:
+//
+//   ts          '0'              same interval as the previous record
+//               '10'   + 7 bits  delta-of-delta, two's complement
+//               '110'  + 9 bits
+//               '1110' + 12 bits
+//               '1111' + 32 bits the timestamp itself
+//   temp, hum,  '0'              same bits as the previous value
+//   vin,        '10'   + n bits  XOR with the previous value, inside the
+//   battery                      previous value's meaningful-bit window
+//               '11' + 5 bits leading zeros + 5 bits (length - 1)
+//                    + length bits of the XOR
+//   pm1, pm25,  zigzag delta from the previous value as a varint of
+//   pm10        3-bit groups, each preceded by a "more follows" bit
+//   status      '0' unchanged, '1' + 16 bits
+//
+// Every block starts from zeroed state, so it decodes on its own, and its
+// header carries the time range and the temp/hum/PM2.5 extremes so a
+// reader can skip blocks without decoding them. Floats are stored bit for
+// bit (NaN included): a decoded record is identical to the logged one.
+// tools/decode_archive.py is the matching decoder.
+//
+// Blocks go to one file per calendar month (local time) of their records,
+// ARCHIVE_DIR/YYYY-MM.bin, so a month can be copied or exported on its
+// own. Next to it, YYYY-MM.idx is the month's sparse index: one
+// ArchiveIndexEntry per block, in block order, so the blocks of a time
+// range are found from a few hundred bytes instead of every block header.
+// The headers stay authoritative; an index can be rebuilt from them.
+
+#define ARCHIVE_MAGIC "AQAR"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_BLOCK_SIZE LOG_BLOCK_SIZE
+
+struct __attribute__((packed)) ArchiveBlockHeader {
+  char magic[4];        // "AQAR"
+  uint8_t version;      // ARCHIVE_VERSION
+  uint8_t reserved;
+  uint16_t count;       // records in the block
+  uint32_t tsMin;       // unix time range of the records with a clock,
+  uint32_t tsMax;       // both 0 if none had one
+  int16_t tempMin;      // 0.01 °C; min > max if no valid reading
+  int16_t tempMax;
+  int16_t humMin;       // 0.01 %RH
+  int16_t humMax;
+  int16_t pm25Min;      // µg/m³
+  int16_t pm25Max;
+  uint16_t payloadCrc;  // CRC-16/CCITT of the bitstream
+  uint16_t crc;         // CRC-16/CCITT of the preceding bytes
+};
+
+static_assert(sizeof(ArchiveBlockHeader) == 32,
+              "ArchiveBlockHeader must stay 32 bytes");
+
+struct __attribute__((packed)) ArchiveIndexEntry {
+  uint32_t tsMin, tsMax; // the block header's, 0 if no record had a clock
+};
+
+const size_t ARCHIVE_PAYLOAD_SIZE =
+    ARCHIVE_BLOCK_SIZE - sizeof(ArchiveBlockHeader);
+
+struct ArchiveFloat {
+  uint32_t bits;
+  uint8_t leading, trailing; // window of the last XOR written in full
+};
+
+struct ArchiveState {
+  uint32_t ts;
+  int64_t interval;
+  ArchiveFloat temp, hum, vin, battery;
+  int16_t pm1, pm25, pm10;
+  uint16_t status;
+};
+
+// Running count and extremes, copied into the header by archiveFinish()
+struct ArchiveStats {
+  uint16_t count;
+  uint32_t tsMin, tsMax;
+  int16_t tempMin, tempMax, humMin, humMax, pm25Min, pm25Max;
+};
+
+struct ArchiveEncoder {
+  uint8_t block[ARCHIVE_BLOCK_SIZE];
+  size_t bitPos; // into the payload
+  ArchiveState state;
+  ArchiveStats stats;
+};
+
+void archiveBegin(ArchiveEncoder &enc);
+// Appends a record; returns false and leaves the block untouched when it
+// does not fit
+bool archiveAdd(ArchiveEncoder &enc, const LogRecord &rec);
+// Writes the header and CRCs; enc.block is then ready to be stored
+void archiveFinish(ArchiveEncoder &enc);
+
+#endif
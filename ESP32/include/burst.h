@@ -0,0 +1,24 @@
+#ifndef BURST_H
+#define BURST_H
+
+#include <Arduino.h>
+
+// ----- POLLUTION-EVENT BURST MODE -----
+// When the wake's reading reaches BURST_ENTER_PM25, the PMS7003 stays in
+// active mode and the wake keeps sampling it and the AHT20 every
+// BURST_PERIOD_MS into a RAM buffer, until PM2.5 has stayed below
+// BURST_EXIT_PM25 for BURST_EXIT_SAMPLES samples or BURST_MAX_MS is up.
+// The samples (STATUS_BURST set) are then appended to the SD log in one
+// write and go out with the wake's upload.
+//
+// Battery limits: on battery power a burst needs BURST_MIN_BATTERY_V, and
+// bursts share BURST_DAILY_MAX_S of sampling per local day (RTC memory).
+
+bool burstShouldStart(int pm25, float vin, float battery, bool sdOk);
+// Samples until the event is over; vin/battery are stamped on each sample
+void runBurst(float vin, float battery);
+uint16_t burstCount();
+// Appends the samples to the log; returns false if the card failed
+bool flushBurst(const char *logFile);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "record.h"
+#include <Arduino.h>
+
+// ----- COMPACT UPLOAD ENCODING -----
+// CBOR (RFC 8949) batch body, sent to RENDER_BATCH_PATH as
+// COMPACT_CONTENT_TYPE instead of JSON:
+//
+//   {0: 2, 1: [_ rec, rec, ...], 2: "<meta JSON>"}
+//
+// Each rec is [ts, temp, hum, pm1, pm25, pm10, battery, vin, status, seq] with
+// temp and hum in 0.01 units and battery and vin in mV. Every field but
+// status is the difference from the previous record (from 0 for the
+// first), so a steady backlog costs about a byte per field; status is the
+// record's STATUS_* bits as is and seq the difference from the previous
+// record's sequence number (usually 1). Version 1 had no seq. A NaN reading is sent as null and leaves
+// the running value where it was. The record array is indefinite-length
+// so records failing their CRC can be skipped while streaming.
+// backend/compact.py is the matching decoder.
+
+#define COMPACT_CONTENT_TYPE "application/cbor"
+#define COMPACT_VERSION 2
+#define COMPACT_FIELDS 8 // delta-coded fields before status
+
+const size_t COMPACT_RECORD_MAX = 1 + COMPACT_FIELDS * 5 + 3 + 5;
+
+struct CompactState {
+  int64_t prev[COMPACT_FIELDS];
+  uint16_t prevSeq;
+};
+
+void compactReset(CompactState &state);
+size_t compactEncodeRecord(const LogRecord &rec, CompactState &state, uint8_t *out);
+
+// CBOR item heads; return the number of bytes written
+size_t cborHead(uint8_t major, uint64_t value, uint8_t *out);
+size_t cborInt(int64_t value, uint8_t *out);
+
+#endif
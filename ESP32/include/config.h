@@ -7,14 +7,36 @@
 #define SD_CS 5
 #define PMS_RX 25
 #define PMS_TX 26
-#define ADC_PIN1 36 // Voltage 1 (Vin)
-#define ADC_PIN2 35 // Voltage 2 (Battery)
+#define ADC_PIN1 36 // Voltage 1 (Vin), ADC1 channel 0
+#define ADC_PIN2 35 // Voltage 2 (Battery), ADC1 channel 7
+
+// ----- SD FILES -----
+#define MASTER_LOG_FILE "/datalog.bin" // binary LogRecord log, see record.h
+#define ARCHIVE_DIR "/archive"        // compressed copy by month, see archive.h
+#define CURSOR_NVS_NAMESPACE "aqms"    // NVS home of the upload cursors
+const uint8_t ARCHIVE_MAX_BLOCKS = 8;  // archive blocks written per wake
+const uint32_t SD_SPI_HZ = 20000000;   // SD.begin() default is 4 MHz
+const uint16_t SD_PREALLOC_BLOCKS = 64; // grow the log 32 KB at a time (0/1: off)
+const uint32_t LOG_COMPACT_RECORDS = 512; // drop this many delivered and archived records at once
 
 // ----- VOLTAGE DIVIDER CONFIG -----
 const float R1 = 9810.0;
 const float R2 = 2150.0;
 const float VOLTAGE_DIVIDER_RATIO = R2 / (R1 + R2); // k
 
+// ----- VOLTAGE ADC (see voltage.h) -----
+#define ADC_NVS_NAMESPACE "adc"       // per-board gains, kept across reflashes
+const uint16_t ADC_DEFAULT_VREF_MV = 1100; // used when eFuse has no Vref
+const uint16_t ADC_SAMPLES = 64;      // per channel, interleaved
+const float ADC_OUTLIER_MADS = 3.0f;  // reject beyond this many MADs
+
+// ----- SERIAL CONSOLE (see console.h) -----
+const uint32_t CONSOLE_WINDOW_MS = 1000; // listen for commands after boot
+const uint32_t CONSOLE_BAUD = 9600;
+const uint32_t EXPORT_BAUD = 921600;     // "export" streams at this rate
+const uint16_t EXPORT_SWITCH_MS = 200;   // for the host to change baud too
+const uint16_t EXPORT_CHUNK_BYTES = 2048; // per frame: 4 archive blocks
+
 // ----- WIFI & API CREDENTIALS -----
 const char *const SSID_NAME = WIFI_SSID;       
 const char *const WIFI_PASSWORD = WIFI_PASS;
@@ -22,12 +44,103 @@ const char *const TS_API_KEY = THINGSPEAK_API_KEY;
 const char *const RENDER_URL = BACKEND_URL;
 const char *const SENSOR_API_KEY = SENSOR_KEY;
 
+// ----- WIFI -----
+const uint32_t WIFI_FAST_TIMEOUT_MS = 3000;     // cached BSSID/IP attempt
+const uint32_t WIFI_CONNECT_TIMEOUT_MS = 10000; // full scan + DHCP
+const uint16_t WIFI_CACHE_MAX_USES = 48;        // renew DHCP lease daily
+
+// ----- RTC READING BUFFER (see rtcbuffer.h) -----
+#define RTC_BUFFER_CAPACITY 96     // readings (32 B each) kept in RTC memory
+const uint16_t RTC_FLUSH_EVERY = 12;     // write to SD every 6 h at least
+const uint16_t RTC_BUFFER_HEADROOM = 4;  // flush early when this close to full
+
+// ----- STORE-AND-FORWARD (see uplink.h) -----
+const uint32_t UPLINK_EVERY_N_CYCLES = 6;       // connect at least every 3 h
+const uint32_t UPLINK_PENDING_THRESHOLD = 48;   // or when this many are queued
+const int UPLINK_PM25_ALERT = 55;               // µg/m³, connect immediately
+const int UPLINK_PM25_JUMP = 25;                // µg/m³ rise since last wake
+const uint32_t UPLINK_BACKOFF_MAX_CYCLES = 24;  // longest wait after failed uplinks
+
+// ----- WAKE SCHEDULE (see scheduler.h) -----
+// Intervals must divide a day so slots line up at the same local times
+const uint32_t SCHEDULE_NORMAL_S = 30 * 60;     // :00 and :30
+const uint32_t SCHEDULE_FAST_S = 5 * 60;        // PM2.5 rising quickly
+const uint32_t SCHEDULE_STABLE_S = 60 * 60;     // readings flat for a while
+const uint32_t SCHEDULE_LOW_BATTERY_S = 60 * 60;
+const uint32_t SCHEDULE_CRITICAL_BATTERY_S = 3 * 60 * 60;
+const float SCHEDULE_PM25_RISE_PER_H = 20;      // µg/m³ per hour to go fast
+const uint8_t SCHEDULE_FAST_HOLD = 6;           // fast wakes after a rise
+const uint8_t SCHEDULE_STABLE_WAKES = 4;        // flat wakes before slowing
+const int SCHEDULE_STABLE_PM25 = 3;             // µg/m³ counted as flat
+const float SCHEDULE_ON_BATTERY_VIN = 4.5f;     // V; below: running on battery
+const float SCHEDULE_BATTERY_LOW_V = 3.6f;
+const float SCHEDULE_BATTERY_CRITICAL_V = 3.4f;
+const float SCHEDULE_BATTERY_HYSTERESIS_V = 0.1f;
+const uint32_t SCHEDULE_MIN_SLEEP_S = 20;       // else skip to the next slot
+const uint32_t SCHEDULE_TIMER_MIN_SLEEP_S = 20 * 60; // shorter sleeps don't teach the timer error
+const uint32_t SCHEDULE_TIMER_WINDOW_S = 24 * 3600;  // sleep the timer estimate averages over
+
+// ----- BURST MODE (see burst.h) -----
+const int BURST_ENTER_PM25 = UPLINK_PM25_ALERT; // µg/m³ that starts a burst
+const int BURST_EXIT_PM25 = 35;                 // µg/m³ counted as over...
+const uint8_t BURST_EXIT_SAMPLES = 6;           // ...for this many samples
+const uint32_t BURST_PERIOD_MS = 5000;
+const uint32_t BURST_MAX_MS = 10 * 60 * 1000;   // longest burst per wake
+const uint32_t BURST_DAILY_MAX_S = 60 * 60;     // burst time per local day
+const float BURST_MIN_BATTERY_V = 3.8f;         // when running on battery
+
+// ----- WAKE CYCLE -----
+const uint32_t NETWORK_TASK_STACK = 6 * 1024; // uploads run in sink tasks
+
+// ----- BACKLOG UPLOAD -----
+const char *const RENDER_BATCH_PATH = "/batch"; // appended to RENDER_URL
+const uint32_t BATCH_MAX_RECORDS = 48;          // records per POST
+const uint32_t BACKLOG_BYTE_BUDGET = 64 * 1024; // request bytes per sink
+const uint32_t BACKLOG_TIME_BUDGET_MS = 20000;  // replay time per sink
+const uint32_t SINK_MAX_GAP_WAIT_MS = 2000;     // longer rate-limit waits defer to the next wake
+const bool RENDER_COMPACT_UPLOAD = true;        // CBOR batches (compact.h)
+
+// ----- UPLOAD SINKS (see uploader.h) -----
+#ifdef THINGSPEAK_CHANNEL_ID
+const char *const TS_CHANNEL_ID = THINGSPEAK_CHANNEL_ID;
+#else
+const char *const TS_CHANNEL_ID = ""; // no bulk replay, live updates only
+#endif
+const uint32_t RENDER_SINK_STACK = 12 * 1024;     // TLS handshake
+const uint32_t THINGSPEAK_SINK_STACK = 6 * 1024;  // plain HTTP
+const uint32_t THINGSPEAK_BULK_MAX_RECORDS = 240; // API allows 960
+const uint32_t THINGSPEAK_BULK_GAP_MS = 15000;    // free-tier rate limit
+const uint32_t THINGSPEAK_BACKFILL = 48;          // first sync: last day only
+
+// ----- WAKE PROFILE (see profiler.h) -----
+#define PROFILE_BUCKETS 12                  // duration buckets per phase
+const uint32_t PROFILE_BUCKET_BASE_MS = 16; // bucket b: < 16 ms << b
+const size_t CYCLE_META_MAX = 1280;         // "meta" JSON incl. agg and profile
+
 // ----- NTP / TIMEZONE -----
 const char *const NTP_SERVER = "pool.ntp.org";
 const long GMT_OFFSET_SEC = 5 * 3600 + 45 * 60; // Nepal
 const int DAYLIGHT_OFFSET_SEC = 0;
+const uint32_t NTP_TIMEOUT_MS = 5000;
+
+// ----- RTC DRIFT MODEL (see rtc.h) -----
+#define CLOCK_NVS_NAMESPACE "clock"
+const float NTP_MAX_ERROR_S = 2.0f;            // sync before the RTC may be this far off
+const float NTP_UNLEARNED_PPM = 20.0f;         // drift assumed before an estimate
+const float NTP_DRIFT_MARGIN_PPM = 2.0f;       // left once learned (temperature, aging)
+const float NTP_DRIFT_MAX_PPM = 100.0f;        // beyond: the RTC was reset, not drift
+const uint32_t NTP_DRIFT_WINDOW_S = 30 * 86400; // history the estimate averages over
+const uint32_t NTP_MAX_INTERVAL_S = 7 * 86400;  // sync at least weekly regardless
+
+// ----- PMS7003 WARM-UP -----
+const uint32_t PMS_WARMUP_MIN_MS = 8000;  // fan spin-up floor
+const uint32_t PMS_WARMUP_MAX_MS = 30000; // old fixed warm-up, now a ceiling
+#define PMS_STABLE_FRAMES 5               // window that must agree
+const uint16_t PMS_STABLE_ABS_TOL = 2;    // µg/m³ spread allowed...
+const float PMS_STABLE_REL_TOL = 0.10f;   // ...or 10% of the median
 
 // ----- PMS7003 COMMANDS -----
+const byte CMD_ACTIVE[] = {0x42, 0x4D, 0xE1, 0x00, 0x01, 0x01, 0x71};
 const byte CMD_PASSIVE[] = {0x42, 0x4D, 0xE1, 0x00, 0x00, 0x01, 0x70};
 const byte CMD_REQUEST[] = {0x42, 0x4D, 0xE2, 0x00, 0x00, 0x01, 0x71};
 const byte CMD_SLEEP[] = {0x42, 0x4D, 0xE4, 0x00, 0x00, 0x01, 0x73};
@@ -0,0 +1,23 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <Arduino.h>
+
+// ----- SERIAL CONSOLE -----
+// Field service commands typed on the USB serial port during the first
+// moments after a wake. Each command keeps the window open for another
+// windowMs, so a technician can type several in a row.
+//
+//   cal vin <volts>   set the Vin gain from a known applied voltage
+//   cal bat <volts>   same for the battery channel
+//   cal show          print gains and current readings
+//   cal reset         back to the uncalibrated gains
+//   export <from> [<to>]
+//                     stream a date range of the SD data (see export.h);
+//                     dates YYYY-MM-DD or YYYY-MM, local time, <to>
+//                     included and defaulting to now
+//   help
+
+void pollConsole(uint32_t windowMs);
+
+#endif
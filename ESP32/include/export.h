@@ -0,0 +1,34 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <Arduino.h>
+
+// ----- BULK EXPORT -----
+// Streams a time range of the SD data over the USB serial port, for the
+// console's "export" command. The archive blocks and log records go out
+// as they are stored on the card (no decoding on the device), so a month
+// takes seconds at EXPORT_BAUD. tools/export.py drives the command and
+// turns the stream into CSV.
+//
+// After its "📤 Export" line the console switches to EXPORT_BAUD, waits
+// EXPORT_SWITCH_MS for the host to follow, and sends "AQEX", a version
+// byte, then frames:
+//
+//   type (1)  length (2)  payload (length)  CRC-16/CCITT of the preceding
+//
+//   'A'  whole archive blocks (archive.h) whose index range meets the
+//        request, up to EXPORT_CHUNK_BYTES per frame
+//   'H'  the master log's LogHeader
+//   'L'  raw LogRecords not archived yet; the host filters them by time
+//   'E'  uint32 blocks, uint32 records, uint32 ms: the end of the stream
+//
+// All fields little-endian. The port then returns to CONSOLE_BAUD.
+
+#define EXPORT_MAGIC "AQEX"
+#define EXPORT_VERSION 1
+
+// from/to are unix times, both included; false if the card is unusable
+bool exportRange(const char *logFile, const char *archiveDir, uint32_t from,
+                 uint32_t to);
+
+#endif
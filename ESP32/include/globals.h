@@ -4,6 +4,7 @@
 #include <Adafruit_AHTX0.h>
 #include <Arduino.h>
 #include <RTClib.h>
+#include "record.h"
 
 
 // ----- HARDWARE OBJECTS -----
@@ -11,18 +12,20 @@ extern HardwareSerial pmsSerial;
 extern Adafruit_AHTX0 aht;
 extern RTC_DS3231 rtc;
 
-// ----- CALIBRATION VARIABLES -----
-extern float Vref1;
-extern float Vref2;
-
 // ----- STATUS FLAGS -----
-extern bool statusAHT;
-extern bool statusRTC;
-extern bool statusPMS;
-extern bool statusWiFi;
-extern bool statusSD;
-extern bool statusThingSpeak;
-extern bool statusRender;
-extern bool statusNTP;
+// STATUS_* bits (record.h) of the current wake. The network task on core 0
+// and setup() on core 1 both update them, hence the atomic read-modify-write.
+extern uint32_t deviceStatus;
+
+inline void setStatus(uint32_t bit, bool ok) {
+  if (ok)
+    __atomic_fetch_or(&deviceStatus, bit, __ATOMIC_RELAXED);
+  else
+    __atomic_fetch_and(&deviceStatus, ~bit, __ATOMIC_RELAXED);
+}
+
+inline bool statusOk(uint32_t bit) {
+  return (__atomic_load_n(&deviceStatus, __ATOMIC_RELAXED) & bit) != 0;
+}
 
 #endif
\ No newline at end of file
@@ -1,13 +1,37 @@
 #ifndef NETWORK_H
 #define NETWORK_H
 
+#include "record.h"
 #include "time.h"
 #include <Arduino.h>
+#include <FS.h>
 
 
+// Time spent on Render uploads during this wake
+struct UploadTiming {
+  uint32_t handshakeMs;
+  uint32_t requestMs;
+  uint16_t handshakes;
+  uint16_t requests;
+};
+
+// How this wake's WiFi connection was made
+struct WiFiStats {
+  uint32_t connectMs;
+  bool fastPath; // joined the cached BSSID/channel/IP without a scan
+};
+
 void connectWiFi();
-void sendToThingSpeak(float temp, float hum, int pm1, int pm25, int pm10, float vin, float battery);
-void sendToRenderBackend(float temp, float hum, int pm1, int pm25, int pm10,
-                         float vin, float battery, struct tm *timeinfo);
+const WiFiStats &getWiFiStats();
+void sendToThingSpeak(const LogRecord &rec);
+void sendToRenderBackend(const LogRecord &rec);
+bool sendBatchToRenderBackend(File &log, uint32_t first, uint32_t count,
+                              bool withMeta, size_t &bytesSent);
+void closeRenderConnection();
+bool thingSpeakBulkEnabled();
+bool sendBatchToThingSpeak(File &log, uint32_t first, uint32_t count,
+                           bool withMeta, size_t &bytesSent);
+void closeThingSpeakConnection();
+const UploadTiming &getUploadTiming();
 
 #endif
\ No newline at end of file
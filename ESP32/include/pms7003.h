@@ -0,0 +1,61 @@
+#ifndef PMS7003_H
+#define PMS7003_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ----- PMS7003 FRAME DECODER -----
+// Byte-at-a-time state machine for the PMS7003 serial protocol. It does
+// not depend on Arduino, so it can be fed from pmsSerial on the device or
+// from a recorded byte stream on a host build.
+//
+// Frame: 0x42 0x4D, 16-bit length, (length - 2) data bytes, 16-bit sum of
+// all preceding bytes. Data frames have length 28 (13 words + checksum);
+// command replies have length 4 and are checked but not emitted.
+
+struct PMSFrame {
+  // Standard particle, CF=1 (µg/m³)
+  uint16_t pm1Cf1, pm25Cf1, pm10Cf1;
+  // Atmospheric environment (µg/m³)
+  uint16_t pm1Atm, pm25Atm, pm10Atm;
+  // Particles > size per 0.1 L of air
+  uint16_t count03, count05, count10, count25, count50, count100;
+  uint8_t version;
+  uint8_t errorCode;
+};
+
+class PMSParser {
+public:
+  PMSParser() { reset(); }
+
+  // Consumes one byte; returns true when it completed a valid data frame,
+  // which is then available from frame().
+  bool feed(uint8_t b);
+
+  const PMSFrame &frame() const { return lastFrame; }
+  // Bytes of a frame in progress, never more than a data frame
+  size_t buffered() const { return have; }
+  void reset();
+
+  uint32_t frames = 0;         // valid data frames decoded
+  uint32_t checksumErrors = 0; // frames dropped on a bad sum
+  uint32_t lengthErrors = 0;   // headers with an impossible length
+  uint32_t skippedBytes = 0;   // bytes discarded while hunting for 0x42 0x4D
+
+private:
+  enum State { WAIT_START1, WAIT_START2, LENGTH, BODY };
+
+  static const size_t MAX_FRAME = 32;
+
+  State state;
+  uint8_t buf[MAX_FRAME];
+  size_t have;   // bytes in buf, header included
+  size_t expect; // total frame size once the length is known
+  PMSFrame lastFrame;
+
+  bool step(uint8_t b);
+  bool finishFrame();
+  void resync();
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// ----- WAKE-CYCLE PROFILER -----
+// Times each phase of a wake with esp_timer_get_time(), tracks the heap
+// low-water mark and the smallest "largest free block" seen at the end of
+// a phase, and counts retries. A duration histogram per phase is kept in
+// RTC memory across wakes and shipped as "profile" inside the upload meta,
+// then cleared once the backend has it.
+//
+// Phases run on both cores (see networkTask in main.cpp), so they overlap
+// and their sum can exceed the active time. The backlog phase includes the
+// uploads it makes, and the upload sinks run in parallel (see uploader.h).
+
+enum ProfilePhase {
+  PHASE_SENSOR_INIT = 0, // RTC, AHT20 and UART bring-up
+  PHASE_AHT,        // AHT20 read
+  PHASE_WIFI,
+  PHASE_NTP,
+  PHASE_PMS,        // PMS7003 wake-up and warm-up
+  PHASE_ADC,
+  PHASE_SD,         // card init and RTC buffer flush
+  PHASE_BACKLOG,    // dispatchUploads()
+  PHASE_UPLOAD,     // each HTTP request to Render
+  PHASE_THINGSPEAK, // each HTTP request to ThingSpeak
+  PHASE_BURST,      // burst sampling (burst.h)
+  PHASE_COUNT
+};
+
+void profileBegin(ProfilePhase phase);
+void profileEnd(ProfilePhase phase);
+void profileRetry(ProfilePhase phase);
+
+// Appends the profile as a JSON object; returns the length like snprintf
+int formatProfile(char *buf, size_t size);
+// The backend accepted an upload carrying formatProfile()'s output
+void profileSent();
+// Folds this wake into the RTC history; call right before deep sleep
+void profileCommit();
+void printProfile();
+
+#endif
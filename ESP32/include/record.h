@@ -0,0 +1,85 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "time.h"
+#include <Arduino.h>
+
+// ----- BINARY LOG FORMAT -----
+// File layout: one LogHeader followed by fixed-size LogRecords.
+// Header and records are both 32 bytes, so no record ever straddles a
+// 512-byte SD sector and record i lives at LOG_HEADER_SIZE + i * LOG_RECORD_SIZE.
+// All fields are little-endian (native ESP32 byte order).
+//
+// Once every reader (upload sinks, archive) is past the first records,
+// they are dropped by rewriting the rest into a new log (compactLog() in
+// storage.h). Its header names the log it came from and how many records
+// went, so cursors saved against the old log still find their place.
+
+#define LOG_MAGIC "AQLG"
+#define LOG_VERSION 1
+#define LOG_BLOCK_SIZE 512
+
+// Status bitfield (LogRecord::status)
+#define STATUS_AHT (1 << 0)
+#define STATUS_RTC (1 << 1)
+#define STATUS_PMS (1 << 2)
+#define STATUS_WIFI (1 << 3)
+#define STATUS_NTP (1 << 4) // time from NTP, or an RTC the drift model vouches for
+#define STATUS_SD (1 << 5)
+#define STATUS_THINGSPEAK (1 << 6)
+#define STATUS_RENDER (1 << 7)
+#define STATUS_BURST (1 << 8) // dense sample from a burst (burst.h)
+
+struct __attribute__((packed)) LogHeader {
+  char magic[4];       // "AQLG"
+  uint16_t version;    // LOG_VERSION
+  uint16_t recordSize; // sizeof(LogRecord)
+  uint32_t logId;      // random id of this file instance
+  uint32_t created;    // unix time the file was created (0 if unknown)
+  uint32_t prevLogId;  // log this one was compacted from (0 if none)
+  uint32_t base;       // records of prevLogId dropped before record 0
+  uint8_t reserved[6];
+  uint16_t crc; // CRC-16/CCITT of the preceding bytes
+};
+
+struct __attribute__((packed)) LogRecord {
+  uint32_t ts;   // unix time (0 if no clock was available)
+  float temp;    // °C
+  float hum;     // %RH
+  float vin;     // V
+  float battery; // V
+  int16_t pm1;   // µg/m³, -1 = no reading
+  int16_t pm25;
+  int16_t pm10;
+  uint16_t status; // STATUS_* bits
+  uint16_t seq;    // per-device counter, wraps; gaps mean lost readings
+  uint16_t crc; // CRC-16/CCITT of the preceding bytes
+};
+
+static_assert(sizeof(LogHeader) == 32, "LogHeader must stay 32 bytes");
+static_assert(sizeof(LogRecord) == 32, "LogRecord must stay 32 bytes");
+static_assert(LOG_BLOCK_SIZE % sizeof(LogRecord) == 0,
+              "records must not straddle SD blocks");
+
+const uint32_t LOG_HEADER_SIZE = sizeof(LogHeader);
+const uint32_t LOG_RECORD_SIZE = sizeof(LogRecord);
+
+uint16_t crc16(const uint8_t *data, size_t len);
+uint16_t packStatusFlags();
+
+// A reading is built in place: beginRecord() numbers it and marks every
+// value missing, the sensor drivers (sensor_registry.h) fill in theirs, and
+// finishRecord() stamps the time and status and seals it.
+void beginRecord(LogRecord &rec);
+void finishRecord(LogRecord &rec, uint32_t ts, uint16_t extraStatus = 0);
+void sealRecord(LogRecord &rec);
+bool recordValid(const LogRecord &rec);
+
+void initLogHeader(LogHeader &hdr, uint32_t created);
+bool logHeaderValid(const LogHeader &hdr);
+// Turns a cursor saved against storedId into a record index of the log
+// with this header; false if it refers to neither this log nor the one it
+// was compacted from
+bool logCursor(const LogHeader &hdr, uint32_t storedId, uint32_t &cursor);
+
+#endif
@@ -5,9 +5,23 @@
 #include <Arduino.h>
 #include <RTClib.h>
 
+// ----- DS3231 DRIFT MODEL -----
+// Each NTP sync compares the DS3231 with NTP, folds the error into a
+// running drift estimate (ppm, weighted by the time between syncs) and
+// sets the DS3231 to the second. In between, every RTC time handed out
+// here has the predicted drift taken off. A wake that has WiFi only waits
+// for NTP when ntpSyncDue(): the DS3231 lost power, or the corrected time
+// may by now be NTP_MAX_ERROR_S off given how well the rate is known.
+// The model lives in RTC memory and NVS (CLOCK_NVS_NAMESPACE).
 
 void initRTC();
+// Whether the corrected RTC time is within NTP_MAX_ERROR_S without NTP
+bool rtcTimeTrusted();
+// Whether this wake should spend up to NTP_TIMEOUT_MS on NTP
+bool ntpSyncDue();
 bool syncTimeAndRTC(struct tm &timeinfo);
 void getRTCTime(struct tm &timeinfo);
+uint32_t rtcLocalSeconds();
+uint32_t rtcUnixTime();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef RTCBUFFER_H
+#define RTCBUFFER_H
+
+#include "record.h"
+#include <Arduino.h>
+
+// ----- RTC-MEMORY READING BUFFER -----
+// Readings are collected in RTC slow memory, which survives deep sleep,
+// and written to the SD log in one append every RTC_FLUSH_EVERY wakes (or
+// before an upload). Most wakes never power up the card. A CRC over the
+// buffer catches garbage left by a cold boot or a brownout.
+
+void initRtcBuffer();
+void rtcBufferPush(const LogRecord &rec);
+uint16_t rtcBufferCount();
+bool rtcBufferShouldFlush();
+bool flushRtcBuffer(const char *logFile);
+
+// SD health and queue length as of the last wake that touched the card
+void rtcBufferNoteSd(bool ok, uint32_t pending);
+bool rtcBufferSdHealthy();
+uint32_t rtcBufferSdPending();
+
+#endif
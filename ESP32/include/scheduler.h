@@ -0,0 +1,44 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// ----- ADAPTIVE WAKE SCHEDULE -----
+// Picks the next wake from the reading just taken and the supply, then
+// aligns it to a wall-clock slot (multiples of the interval since local
+// midnight), so every unit samples at :00/:30 together:
+//
+//   critical battery   SCHEDULE_CRITICAL_BATTERY_S
+//   low battery        SCHEDULE_LOW_BATTERY_S (SCHEDULE_NORMAL_S while
+//                      PM2.5 is rising)
+//   PM2.5 rising       SCHEDULE_FAST_S for SCHEDULE_FAST_HOLD wakes
+//   PM2.5 flat         SCHEDULE_STABLE_S
+//   otherwise          SCHEDULE_NORMAL_S
+//
+// Battery levels only count while Vin says the unit runs on battery, and
+// have hysteresis. The deep-sleep timer runs off the ESP32's RC slow
+// clock, which can be a few percent off; each wake compares when it woke
+// with the slot it aimed for (on the DS3231) and corrects the next sleep
+// by the learned error. Everything lives in RTC memory. Without a clock
+// the schedule falls back to an unaligned interval.
+
+enum ScheduleMode {
+  SCHED_NORMAL = 0,
+  SCHED_FAST,
+  SCHED_STABLE,
+  SCHED_LOW_BATTERY,
+  SCHED_CRITICAL_BATTERY,
+};
+
+struct ScheduleInput {
+  uint32_t localNow; // DS3231 local time as seconds since 1970, 0 if none
+  uint32_t awakeMs;  // since this wake began
+  int pm25;          // -1 without a reading
+  float vin, battery;
+};
+
+// Returns how long to deep sleep, in ms
+uint64_t scheduleNextWake(const ScheduleInput &in);
+const char *scheduleModeName(ScheduleMode mode);
+
+#endif
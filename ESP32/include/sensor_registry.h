@@ -0,0 +1,67 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include "globals.h"
+#include "profiler.h"
+#include "record.h"
+#include <Arduino.h>
+
+// ----- SENSOR REGISTRY -----
+// The sensors fitted to a build are listed once, as template arguments:
+//
+//   typedef SensorRegistry<Aht20Sensor, Pms7003Sensor, SupplySensor> Sensors;
+//   Sensors::begin();
+//   Sensors::read(record);
+//
+// A driver is a struct of static members, so every call is resolved at
+// compile time (no vtables, nothing on the heap):
+//
+//   struct Co2Sensor {
+//     static const ProfilePhase PHASE = PHASE_CO2;  // profiler slot for read()
+//     static const uint16_t STATUS = STATUS_CO2;    // health bit, 0 for none
+//     static bool begin();                          // bring-up, once per wake
+//     static bool read(LogRecord &rec);             // fill in its fields
+//   };
+//
+// Drivers run in list order. Fields of the packed LogRecord cannot bind to
+// references, so a driver reads into locals and assigns them.
+
+template <typename... Drivers> struct SensorRegistry {
+  static const size_t COUNT = sizeof...(Drivers);
+
+  // Returns how many drivers came up. Not profiled here: the caller times
+  // it with the rest of the bring-up as PHASE_SENSOR_INIT.
+  static uint8_t begin() {
+    bool ok[] = {track<Drivers>(Drivers::begin())...};
+    return countTrue(ok);
+  }
+
+  // Returns how many drivers delivered a reading
+  static uint8_t read(LogRecord &rec) {
+    bool ok[] = {readOne<Drivers>(rec)...};
+    return countTrue(ok);
+  }
+
+private:
+  template <typename S> static bool track(bool ok) {
+    if (S::STATUS)
+      setStatus(S::STATUS, ok);
+    return ok;
+  }
+
+  template <typename S> static bool readOne(LogRecord &rec) {
+    profileBegin(S::PHASE);
+    bool ok = S::read(rec);
+    profileEnd(S::PHASE);
+    return track<S>(ok);
+  }
+
+  static uint8_t countTrue(const bool (&ok)[COUNT]) {
+    uint8_t n = 0;
+    for (size_t i = 0; i < COUNT; i++)
+      n += ok[i];
+    return n;
+  }
+};
+
+#endif
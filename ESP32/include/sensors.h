@@ -3,14 +3,43 @@
 
 #include "config.h"
 #include "globals.h"
+#include "pms7003.h"
+#include "profiler.h"
+#include "record.h"
 #include <Arduino.h>
 
 
-void initSensors();
+// How the last PMS7003 warm-up went
+struct PMSStats {
+  uint32_t warmupMs;
+  uint16_t frames;
+  bool converged; // false if PMS_WARMUP_MAX_MS ran out first
+  uint16_t badFrames; // dropped on checksum or length errors
+};
+
 void sendPMSCommand(const byte *cmd);
 float readTemperature(float &humidityOut);
 bool readPMData(int &pm1_0, int &pm2_5, int &pm10);
-float readVoltage(int pin, float Vref_cal);
-void calibrateVref(int pin, float knownVin, float &Vref_cal);
+// Next active-mode frame (atmospheric PM1/2.5/10) after readPMData()
+bool readPMSFrame(uint16_t pm[3], uint32_t deadline);
+const PMSStats &getPMSStats();
+const PMSFrame &getLastPMSFrame();
+
+// ----- SENSOR DRIVERS (see sensor_registry.h) -----
+struct Aht20Sensor {
+  static const ProfilePhase PHASE = PHASE_AHT;
+  static const uint16_t STATUS = STATUS_AHT;
+  static bool begin(); // also brings up the I2C bus
+  static bool read(LogRecord &rec);
+};
+
+// Warms the PMS7003 up (readPMData) and leaves it streaming for a burst;
+// the caller puts it back to sleep with CMD_SLEEP.
+struct Pms7003Sensor {
+  static const ProfilePhase PHASE = PHASE_PMS;
+  static const uint16_t STATUS = STATUS_PMS;
+  static bool begin();
+  static bool read(LogRecord &rec);
+};
 
 #endif
\ No newline at end of file
@@ -1,16 +1,41 @@
 #ifndef STORAGE_H
 #define STORAGE_H
 
+#include "record.h"
 #include "time.h"
 #include <Arduino.h>
+#include <FS.h>
 
 
 
+// Mounts the card once per wake at SD_SPI_HZ
 void initSD();
-void logToSD(const char *filename, float temp, float hum, int pm1, int pm25, int pm10, float vin, float battery,
-             struct tm *timeinfo);
-void logToBacklog(const char *filename, float temp, float hum, int pm1, int pm25, int pm10, float v1, float v2,
-                  struct tm *timeinfo);
-void processBacklog(const char *backlogFile);
+void logToSD(const char *filename, const LogRecord &rec);
+// Buffers records for the log; they reach the card in whole 512-byte
+// blocks, the last partial one on flushLog()
+bool appendRecords(const char *filename, const LogRecord *recs, size_t n);
+bool flushLog();
+// The log's newest record as it stands on the card (or in the writer's
+// buffer); false for a missing or empty log
+bool lastLogRecord(const char *filename, LogRecord &rec);
+void closeLog();
+// Flushes and closes the log and unmounts the card; call before sleep
+void closeStorage();
+uint32_t logRecordCount(File &file);
+bool readRecord(File &file, uint32_t index, LogRecord &rec);
+// Compresses full blocks of the log into the monthly partitions under
+// archiveDir (see archive.h)
+void archiveLog(const char *logFile, const char *archiveDir);
+// Local calendar month of ts as year * 12 + month (0-11); 0 for no clock
+uint32_t archiveMonth(uint32_t ts);
+// <archiveDir>/YYYY-MM.<ext> for an archiveMonth() ("undated" for 0)
+void archivePartitionPath(char *buf, size_t size, const char *archiveDir,
+                          uint32_t month, const char *ext);
+// Index of the first record of the log with this header not archived yet
+uint32_t archiveCursor(const LogHeader &hdr);
+// Drops the log's first `drop` records (see record.h); hdr receives the new
+// log's header. After an SD error the old log is still in place, or the
+// new one takes its place when the log is next opened for writing.
+bool compactLog(const char *logFile, uint32_t drop, LogHeader &hdr);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <Arduino.h>
+
+// ----- STORE-AND-FORWARD POLICY -----
+// Decides on each wake whether the radio comes on. Readings always go to
+// the SD log; WiFi is only brought up to flush them as one batch. Failed
+// attempts back off (see uplink.cpp).
+
+enum UplinkReason {
+  UPLINK_NONE = 0,  // stay offline, reading stays queued in the log
+  UPLINK_SCHEDULED, // every UPLINK_EVERY_N_CYCLES wakes
+  UPLINK_BACKLOG,   // pending records reached UPLINK_PENDING_THRESHOLD
+  UPLINK_PM_ALERT,  // PM2.5 crossed the alert level or spiked
+  UPLINK_FAULT,     // a sensor or the SD card failed since the last upload
+};
+
+// Reasons known at boot, so WiFi can come up while the sensors warm up
+UplinkReason uplinkDueBeforeReading(uint32_t pending, bool sdOk);
+// Full decision once the reading is in
+UplinkReason shouldConnect(int pm25, uint16_t status, uint32_t pending);
+// attempted: the radio came on this wake; uploaded: Render took the
+// reading. status: the reading's flags, whose faults are then known
+void recordUplinkResult(bool attempted, bool uploaded, int pm25,
+                        uint16_t status);
+const char *uplinkReasonName(UplinkReason reason);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef UPLOADER_H
+#define UPLOADER_H
+
+#include <Arduino.h>
+
+// ----- UPLOAD DISPATCHER -----
+// The master log is replayed to every enabled upload sink (Render, the
+// ThingSpeak bulk API, ...). Each sink has its own encoder, batch limits
+// and replay cursor in NVS, so a sink that is down or rate limited falls
+// behind without holding back the others.
+//
+// dispatchUploads() runs one task per sink, all on core 0 next to the WiFi
+// stack, and returns when every sink has drained its cursor or spent its
+// byte/time budget for this call. The radio's wait for each server's
+// reply overlaps, so another sink costs little extra awake time.
+//
+// Adding a sink: write its sendBatch() (see network.h) and add an entry
+// with fresh NVS keys to SINKS in uploader.cpp.
+
+// withMeta: attach the cycle meta (profile, aggregates, PMS stats) to the
+// last batch. Only the dispatch after this wake's reading may: the meta
+// describes the wake, and sending it clears the profile history.
+void dispatchUploads(const char *logFile, bool withMeta);
+// Closes the sinks' connections; call once after the last dispatch
+void finishUploads();
+// Records the sink furthest behind has not yet sent
+uint32_t pendingUploads(const char *logFile);
+// Drops the records every enabled sink and the archive are past from the
+// front of the log, once there are LOG_COMPACT_RECORDS of them
+void pruneLog(const char *logFile);
+
+#endif
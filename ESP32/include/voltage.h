@@ -0,0 +1,42 @@
+#ifndef VOLTAGE_H
+#define VOLTAGE_H
+
+#include "profiler.h"
+#include "record.h"
+#include <Arduino.h>
+
+// ----- SUPPLY VOLTAGE MEASUREMENT -----
+// Vin (ADC_PIN1) and battery (ADC_PIN2) are sampled interleaved through
+// the ADC1 one-shot driver, back to back with no delays. Each channel's
+// samples are filtered (median ± ADC_OUTLIER_MADS median absolute
+// deviations), averaged, turned into millivolts with the chip's
+// esp_adc_cal characterisation and scaled by the divider ratio and a
+// per-board gain. The gains live in NVS, so a calibration survives
+// reflashing; see the "cal" console command (console.h).
+
+enum VoltageChannel { VOLT_VIN = 0, VOLT_BATTERY, VOLT_COUNT };
+
+struct VoltageStats {
+  uint32_t us;                  // time spent sampling
+  uint16_t samples;             // per channel
+  uint16_t rejected[VOLT_COUNT];
+};
+
+void initVoltage();
+void readVoltages(float &vin, float &battery);
+const VoltageStats &getVoltageStats();
+
+// Sets a channel's gain so its reading matches a known applied voltage
+bool calibrateVoltage(VoltageChannel ch, float knownVolts);
+float getVoltageGain(VoltageChannel ch);
+void resetVoltageCalibration();
+
+// Vin and battery as a sensor driver (see sensor_registry.h)
+struct SupplySensor {
+  static const ProfilePhase PHASE = PHASE_ADC;
+  static const uint16_t STATUS = 0; // no health bit of its own
+  static bool begin();
+  static bool read(LogRecord &rec);
+};
+
+#endif
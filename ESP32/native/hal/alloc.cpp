@@ -0,0 +1,64 @@
+#include "sim.h"
+#include <execinfo.h>
+#include <new>
+#include <stdlib.h>
+
+namespace sim {
+
+static const int MAX_SITES = 4, SITE_DEPTH = 8;
+static bool counting = false;
+static int halDepth = 0;
+static uint32_t allocs = 0;
+static void *sites[MAX_SITES][SITE_DEPTH];
+static int siteDepth[MAX_SITES];
+
+HalScope::HalScope() { halDepth++; }
+HalScope::~HalScope() { halDepth--; }
+
+void allocCheckStart() {
+  allocs = 0;
+  counting = true;
+}
+
+uint32_t allocCount() { return allocs; }
+
+static void noteAlloc() {
+  if (!counting || halDepth)
+    return;
+  HalScope hal; // backtrace() may allocate on first use
+  if (allocs < MAX_SITES)
+    siteDepth[allocs] = backtrace(sites[allocs], SITE_DEPTH);
+  allocs++;
+}
+
+void printAllocSites(int fd) {
+  for (uint32_t i = 0; i < allocs && i < MAX_SITES; i++) {
+    dprintf(fd, "heap allocation #%u from:\n", i + 1);
+    backtrace_symbols_fd(sites[i] + 1, siteDepth[i] - 1, fd);
+  }
+}
+
+} // namespace sim
+
+static void *countedAlloc(size_t size) {
+  sim::noteAlloc();
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  sim::noteAlloc();
+  return malloc(size ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  sim::noteAlloc();
+  return malloc(size ? size : 1);
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
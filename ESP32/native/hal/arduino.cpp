@@ -0,0 +1,337 @@
+#include "hal_internal.h"
+#include "sim.h"
+#include <Arduino.h>
+#include <esp_adc_cal.h>
+#include <esp_heap_caps.h>
+#include <esp_sntp.h>
+#include <esp_sleep.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+#include <malloc.h>
+#include <new>
+
+HardwareSerial Serial(0);
+
+// ----- TIME -----
+unsigned long millis() { return sim::nowUs() / 1000; }
+unsigned long micros() { return sim::nowUs(); }
+void delay(unsigned long ms) { sim::advanceMs(ms); }
+void delayMicroseconds(unsigned int us) { sim::advanceUs(us); }
+int64_t esp_timer_get_time() { return sim::nowUs(); }
+
+static bool ntpConfigured = false;
+static bool ntpSynced = false;   // SNTP set the clock during this wake
+static bool ntpReported = false; // ...and sntp_get_sync_status() said so
+static uint64_t ntpStartUs = 0;
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char *server1,
+                const char *server2, const char *server3) {
+  // Same POSIX TZ string the ESP32 core builds (sign is inverted)
+  long off = gmtOffset_sec + daylightOffset_sec;
+  char tz[32];
+  snprintf(tz, sizeof(tz), "UTC%c%02ld:%02ld", off > 0 ? '-' : '+',
+           labs(off) / 3600, (labs(off) % 3600) / 60);
+  setenv("TZ", tz, 1);
+  tzset();
+  ntpConfigured = true;
+  ntpStartUs = sim::nowUs();
+}
+
+sntp_sync_status_t sntp_get_sync_status() {
+  if (!ntpConfigured || !sim::wifiConnected() || ntpReported)
+    return SNTP_SYNC_STATUS_RESET;
+  if (sim::nowUs() - ntpStartUs < sim::scenario().ntpMs * 1000ULL)
+    return SNTP_SYNC_STATUS_IN_PROGRESS;
+  ntpSynced = ntpReported = true;
+  return SNTP_SYNC_STATUS_COMPLETED;
+}
+
+bool getLocalTime(struct tm *info, uint32_t ms) {
+  if (ntpSynced) { // the clock is set: no wait
+    time_t now = sim::wallClockUs() / 1000000;
+    localtime_r(&now, info);
+    return true;
+  }
+  if (!ntpConfigured || !sim::wifiConnected()) {
+    sim::advanceMs(ms);
+    return false;
+  }
+  sim::advanceMs(sim::scenario().ntpMs);
+  time_t now = sim::wallClockUs() / 1000000;
+  localtime_r(&now, info);
+  return true;
+}
+
+uint32_t esp_random() {
+  static uint32_t state = 0;
+  if (!state)
+    state = 0x9E3779B9u ^ (sim::cycleIndex() * 2654435761u) ^ (uint32_t)sim::wallClockUs();
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// ----- ADC -----
+int analogRead(uint8_t pin) {
+  // A little deterministic noise so averaging code has something to do
+  static uint32_t n = 0;
+  int noise = (int)((n++ * 7) % 7) - 3;
+  int raw = pin == 36 ? sim::scenario().adc1 : pin == 35 ? sim::scenario().adc2 : 0;
+  sim::advanceUs(10);
+  return std::max(0, std::min(4095, raw + noise));
+}
+void analogReadResolution(uint8_t bits) {}
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation) {}
+
+esp_err_t adc1_config_width(adc_bits_width_t width) { return ESP_OK; }
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten) {
+  return ESP_OK;
+}
+
+int adc1_get_raw(adc1_channel_t channel) {
+  static uint32_t n = 0;
+  n++;
+  int noise = (int)((n * 7) % 7) - 3;
+  if (n % 50 == 0)
+    noise += 400; // switching spike from the charger
+  int raw = channel == ADC1_CHANNEL_0 ? sim::scenario().adc1
+            : channel == ADC1_CHANNEL_7 ? sim::scenario().adc2 : 0;
+  sim::advanceUs(40);
+  return std::max(0, std::min(4095, raw + noise));
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten,
+                                             adc_bits_width_t bit_width,
+                                             uint32_t default_vref,
+                                             esp_adc_cal_characteristics_t *chars) {
+  *chars = {adc_num, atten, bit_width, 3550, 0, default_vref};
+  return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading,
+                                    const esp_adc_cal_characteristics_t *chars) {
+  return (adc_reading * chars->coeff_a + 2047) / 4095 + chars->coeff_b;
+}
+
+// ----- HEAP -----
+static const uint32_t DEVICE_HEAP_BYTES = 320 * 1024;
+static uint32_t heapLowWater = DEVICE_HEAP_BYTES;
+
+uint32_t esp_get_free_heap_size() {
+  size_t used = mallinfo2().uordblks;
+  uint32_t free = used < DEVICE_HEAP_BYTES ? DEVICE_HEAP_BYTES - used : 0;
+  if (free < heapLowWater)
+    heapLowWater = free;
+  return free;
+}
+
+uint32_t esp_get_minimum_free_heap_size() {
+  esp_get_free_heap_size();
+  return heapLowWater;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) { return esp_get_free_heap_size(); }
+
+// No fragmentation model: about what a fresh ESP32 heap offers
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  return std::min<size_t>(esp_get_free_heap_size(), 110 * 1024);
+}
+
+// ----- SLEEP -----
+static uint64_t sleepTimerUs = 0;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  sleepTimerUs = time_in_us;
+  return 0;
+}
+
+void esp_deep_sleep_start() { sim::deepSleep(sleepTimerUs); }
+
+// ----- FreeRTOS -----
+struct NativeEventGroup {
+  EventBits_t bits;
+};
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  fn(param);
+  return pdPASS;
+}
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name,
+                                           uint32_t stackDepth, void *param,
+                                           UBaseType_t priority, StackType_t *stack,
+                                           StaticTask_t *tcb, BaseType_t core) {
+  fn(param);
+  return tcb;
+}
+
+void vTaskDelete(TaskHandle_t task) {}
+void vTaskSuspend(TaskHandle_t task) {}
+void vTaskDelay(TickType_t ticks) { sim::advanceMs(ticks); }
+
+EventGroupHandle_t xEventGroupCreate() { return new NativeEventGroup{0}; }
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *buffer) {
+  static_assert(sizeof(StaticEventGroup_t) >= sizeof(NativeEventGroup),
+                "StaticEventGroup_t too small");
+  return new (buffer) NativeEventGroup{0};
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits) {
+  return g->bits |= bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits) {
+  EventBits_t before = g->bits;
+  g->bits &= ~bits;
+  return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t g) { return g->bits; }
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits,
+                                BaseType_t clearOnExit, BaseType_t waitForAll,
+                                TickType_t ticks) {
+  EventBits_t have = g->bits;
+  bool done = waitForAll ? (have & bits) == bits : (have & bits) != 0;
+  if (!done) {
+    sim::advanceMs(ticks == portMAX_DELAY ? 0 : ticks);
+  } else if (clearOnExit) {
+    g->bits &= ~bits;
+  }
+  return have;
+}
+
+// ----- String -----
+void String::trim() {
+  size_t b = s.find_first_not_of(" \t\r\n");
+  size_t e = s.find_last_not_of(" \t\r\n");
+  s = b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+void String::toCharArray(char *buf, unsigned int size) const {
+  if (!size)
+    return;
+  strncpy(buf, s.c_str(), size - 1);
+  buf[size - 1] = '\0';
+}
+
+// ----- Print / Stream -----
+size_t Print::write(const uint8_t *buf, size_t size) {
+  size_t n = 0;
+  while (size--)
+    n += write(*buf++);
+  return n;
+}
+
+size_t Print::printf(const char *fmt, ...) {
+  sim::HalScope hal;
+  char small[256];
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(small, sizeof(small), fmt, args);
+  va_end(args);
+  if (len < 0)
+    return 0;
+  if ((size_t)len < sizeof(small))
+    return write((const uint8_t *)small, len);
+  std::string big(len + 1, '\0');
+  va_start(args, fmt);
+  vsnprintf(&big[0], big.size(), fmt, args);
+  va_end(args);
+  return write((const uint8_t *)big.data(), len);
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0)
+      return c;
+    delay(1);
+  } while (millis() - start < timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(uint8_t *buf, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = timedRead();
+    if (c < 0)
+      break;
+    buf[n++] = (uint8_t)c;
+  }
+  return n;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buf, size_t length) {
+  size_t n = 0;
+  while (n < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator)
+      break;
+    buf[n++] = (char)c;
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string s;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    s += (char)c;
+    c = timedRead();
+  }
+  return String(s);
+}
+
+// ----- HardwareSerial -----
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rx, int8_t tx) {
+  if (uart == 2)
+    sim::pmsBegin();
+}
+
+// UART0 input is Scenario::console, typed in at the start of the wake
+static size_t consolePos = 0;
+
+int HardwareSerial::available() {
+  if (uart == 2)
+    return sim::pmsAvailable();
+  return uart == 0 ? sim::scenario().console.size() - consolePos : 0;
+}
+
+int HardwareSerial::read() {
+  if (uart == 2)
+    return sim::pmsRead();
+  int c = peek();
+  if (c >= 0)
+    consolePos++;
+  return c;
+}
+
+int HardwareSerial::peek() {
+  if (uart == 2)
+    return sim::pmsPeek();
+  const std::string &in = sim::scenario().console;
+  return uart == 0 && consolePos < in.size() ? (uint8_t)in[consolePos] : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t size) {
+  if (uart == 2)
+    sim::pmsWrite(buf, size);
+  else
+    fwrite(buf, 1, size, stdout);
+  return size;
+}
+
+void HardwareSerial::flush() {
+  if (uart != 2)
+    fflush(stdout);
+}
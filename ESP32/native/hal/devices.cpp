@@ -0,0 +1,369 @@
+#include "hal_internal.h"
+#include "sim.h"
+#include <Adafruit_AHTX0.h>
+#include <Preferences.h>
+#include <RTClib.h>
+#include <Wire.h>
+#include <deque>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TwoWire Wire;
+
+// ----- DS3231 -----
+// Persisted: the RTC reading at the moment it was last set, the true
+// wall clock at that moment, and whether the coin cell ever lost power.
+struct Ds3231State {
+  uint64_t setWallUs;
+  uint32_t setValue;
+  uint8_t lostPower;
+};
+
+static const int32_t DS3231_DEFAULT_OFFSET_S = 5 * 3600 + 45 * 60; // set to Nepal time
+
+static void saveDs3231(const Ds3231State &s) {
+  FILE *f = fopen(sim::statePath("ds3231.bin").c_str(), "wb");
+  if (f) {
+    fwrite(&s, sizeof(s), 1, f);
+    fclose(f);
+  }
+}
+
+static Ds3231State loadDs3231() {
+  Ds3231State s;
+  FILE *f = fopen(sim::statePath("ds3231.bin").c_str(), "rb");
+  if (f && fread(&s, sizeof(s), 1, f) == 1) {
+    fclose(f);
+    return s;
+  }
+  if (f)
+    fclose(f);
+  s.setWallUs = sim::wallClockUs();
+  s.setValue = s.setWallUs / 1000000 + DS3231_DEFAULT_OFFSET_S +
+               sim::scenario().rtcOffsetS;
+  s.lostPower = 0;
+  saveDs3231(s); // else it restarts from the wall clock and never drifts
+  return s;
+}
+
+DateTime::DateTime(uint32_t t) {
+  time_t tt = t;
+  struct tm tm;
+  gmtime_r(&tt, &tm);
+  yOff = tm.tm_year + 1900 - 2000;
+  m = tm.tm_mon + 1;
+  d = tm.tm_mday;
+  hh = tm.tm_hour;
+  mm = tm.tm_min;
+  ss = tm.tm_sec;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour,
+                   uint8_t min, uint8_t sec)
+    : yOff(year >= 2000 ? year - 2000 : year), m(month), d(day), hh(hour),
+      mm(min), ss(sec) {}
+
+uint32_t DateTime::unixtime() const {
+  struct tm tm = {};
+  tm.tm_year = yOff + 2000 - 1900;
+  tm.tm_mon = m - 1;
+  tm.tm_mday = d;
+  tm.tm_hour = hh;
+  tm.tm_min = mm;
+  tm.tm_sec = ss;
+  return (uint32_t)timegm(&tm);
+}
+
+bool RTC_DS3231::begin() {
+  sim::advanceUs(200);
+  return sim::scenario().rtc;
+}
+
+bool RTC_DS3231::lostPower() {
+  sim::HalScope hal;
+  return loadDs3231().lostPower;
+}
+
+DateTime RTC_DS3231::now() {
+  sim::HalScope hal;
+  Ds3231State s = loadDs3231();
+  double elapsed = (double)(sim::wallClockUs() - s.setWallUs) / 1e6;
+  elapsed *= 1.0 + sim::scenario().rtcDriftPpm / 1e6;
+  sim::advanceUs(200);
+  return DateTime(s.setValue + (uint32_t)elapsed);
+}
+
+void RTC_DS3231::adjust(const DateTime &dt) {
+  sim::HalScope hal;
+  Ds3231State s = {sim::wallClockUs(), dt.unixtime(), 0};
+  saveDs3231(s);
+}
+
+// ----- AHT20 -----
+bool Adafruit_AHTX0::begin() {
+  sim::advanceMs(40);
+  return sim::scenario().aht;
+}
+
+bool Adafruit_AHTX0::getEvent(sensors_event_t *humidity, sensors_event_t *temp) {
+  sim::advanceMs(80); // measurement time
+  const sim::Scenario &sc = sim::scenario();
+  bool ok = sc.aht;
+  temp->temperature = ok ? sc.temp : NAN;
+  humidity->relative_humidity = ok ? sc.hum : NAN;
+  return ok;
+}
+
+// ----- PMS7003 -----
+// Emits a 32-byte data frame every second while awake in active mode, or
+// one per CMD_REQUEST in passive mode. Readings start off high and settle
+// onto the scenario values over pmsSettleMs, like the real fan and laser
+// warming up. With a capture file the recorded bytes are replayed at the
+// 9600-baud line rate instead. The UART RX FIFO holds 256 bytes.
+static const size_t PMS_RX_BUFFER = 256;
+static std::deque<uint8_t> pmsRx;
+static bool pmsAwake = true, pmsActive = true;
+static uint64_t pmsWakeUs = 0, pmsNextUs = 0;
+static std::string pmsCapture;
+static size_t pmsCapturePos = 0;
+static uint8_t pmsCmd[7];
+static size_t pmsCmdLen = 0;
+
+static void pmsPush(const uint8_t *b, size_t n) {
+  while (n--) {
+    if (pmsRx.size() < PMS_RX_BUFFER)
+      pmsRx.push_back(*b);
+    b++;
+  }
+}
+
+static uint16_t pmsValue(int target, uint64_t sinceWakeUs, int channel) {
+  uint32_t ms = sinceWakeUs / 1000;
+  uint32_t settle = sim::scenario().pmsSettleMs;
+  int v = target;
+  if (ms < settle)
+    v += (int)((target * 0.8f + 10) * (1.0f - (float)ms / settle));
+  // +-1 jitter that differs per frame and channel
+  v += (int)((ms / 1000 + channel * 3) % 3) - 1;
+  return v < 0 ? 0 : v;
+}
+
+static void pmsEmitFrame(uint64_t atUs) {
+  const sim::Scenario &sc = sim::scenario();
+  uint64_t t = atUs - pmsWakeUs;
+  uint16_t atm[3] = {pmsValue(sc.pm1, t, 0), pmsValue(sc.pm25, t, 1), pmsValue(sc.pm10, t, 2)};
+  uint16_t coarse = atm[2] > atm[1] ? atm[2] - atm[1] : 0;
+  uint16_t words[13] = {
+      (uint16_t)(atm[0] * 11 / 10), (uint16_t)(atm[1] * 11 / 10), (uint16_t)(atm[2] * 11 / 10),
+      atm[0], atm[1], atm[2],
+      (uint16_t)(atm[1] * 120), (uint16_t)(atm[1] * 35), (uint16_t)(atm[1] * 6),
+      (uint16_t)(coarse + 1), (uint16_t)(coarse / 2), 0,
+      0x9700, // version 0x97, no error
+  };
+  uint8_t frame[32] = {0x42, 0x4D, 0x00, 28};
+  for (int i = 0; i < 13; i++) {
+    frame[4 + 2 * i] = words[i] >> 8;
+    frame[5 + 2 * i] = words[i] & 0xFF;
+  }
+  uint16_t sum = 0;
+  for (int i = 0; i < 30; i++)
+    sum += frame[i];
+  frame[30] = sum >> 8;
+  frame[31] = sum & 0xFF;
+  pmsPush(frame, sizeof(frame));
+}
+
+// Brings the RX FIFO up to the current virtual time
+static void pmsPump() {
+  if (!sim::scenario().pms || !pmsAwake)
+    return;
+  sim::HalScope hal; // the UART FIFO stand-in grows in chunks
+  uint64_t now = sim::nowUs();
+  if (!pmsCapture.empty()) {
+    // 9600 8N1 is ~0.96 bytes/ms
+    while (pmsNextUs <= now) {
+      uint8_t b = pmsCapture[pmsCapturePos++ % pmsCapture.size()];
+      pmsPush(&b, 1);
+      pmsNextUs += 1042;
+    }
+    return;
+  }
+  while (pmsActive && pmsNextUs <= now) {
+    pmsEmitFrame(pmsNextUs);
+    pmsNextUs += 1000000;
+  }
+}
+
+static void pmsCommand(const uint8_t *c) {
+  uint16_t sum = 0;
+  for (int i = 0; i < 5; i++)
+    sum += c[i];
+  if (((c[5] << 8) | c[6]) != sum)
+    return; // the sensor ignores commands with a bad checksum
+  pmsPump();
+  uint8_t cmd = c[2], data = c[4];
+  if (cmd == 0xE4) {
+    if (data && !pmsAwake) {
+      pmsWakeUs = sim::nowUs();
+      pmsNextUs = pmsWakeUs + 1000000;
+    }
+    pmsAwake = data;
+  } else if (cmd == 0xE1) {
+    pmsActive = data;
+    if (pmsActive && pmsNextUs < sim::nowUs())
+      pmsNextUs = sim::nowUs() + 1000000;
+  } else if (cmd == 0xE2 && pmsAwake && !pmsActive && sim::scenario().pms) {
+    pmsEmitFrame(sim::nowUs());
+  }
+}
+
+namespace sim {
+
+void pmsBegin() {
+  sim::HalScope hal;
+  const Scenario &sc = scenario();
+  if (sc.pmsHasCapture && pmsCapture.empty()) {
+    FILE *f = fopen(sc.pmsCapture.c_str(), "rb");
+    if (f) {
+      char buf[4096];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        pmsCapture.append(buf, n);
+      fclose(f);
+    }
+  }
+  // The sensor keeps its own power state across the ESP32's deep sleep
+  FILE *f = fopen(statePath("pms.bin").c_str(), "rb");
+  if (f) {
+    uint8_t awake;
+    if (fread(&awake, 1, 1, f) == 1)
+      pmsAwake = awake;
+    fclose(f);
+  }
+  pmsWakeUs = nowUs();
+  pmsNextUs = pmsWakeUs + 1000000;
+}
+
+int pmsAvailable() {
+  pmsPump();
+  return pmsRx.size();
+}
+
+int pmsRead() {
+  pmsPump();
+  if (pmsRx.empty())
+    return -1;
+  int c = pmsRx.front();
+  pmsRx.pop_front();
+  return c;
+}
+
+int pmsPeek() {
+  pmsPump();
+  return pmsRx.empty() ? -1 : pmsRx.front();
+}
+
+void pmsWrite(const uint8_t *buf, size_t size) {
+  sim::HalScope hal;
+  while (size--) {
+    uint8_t b = *buf++;
+    if (pmsCmdLen == 0 && b != 0x42)
+      continue;
+    if (pmsCmdLen == 1 && b != 0x4D) {
+      pmsCmdLen = 0;
+      continue;
+    }
+    pmsCmd[pmsCmdLen++] = b;
+    if (pmsCmdLen == sizeof(pmsCmd)) {
+      pmsCommand(pmsCmd);
+      pmsCmdLen = 0;
+    }
+  }
+  FILE *f = fopen(statePath("pms.bin").c_str(), "wb");
+  if (f) {
+    uint8_t awake = pmsAwake;
+    fwrite(&awake, 1, 1, f);
+    fclose(f);
+  }
+}
+
+} // namespace sim
+
+// ----- Preferences -----
+static void makeDirs(const std::string &path) {
+  for (size_t i = 1; i <= path.size(); i++) {
+    if (i == path.size() || path[i] == '/')
+      mkdir(path.substr(0, i).c_str(), 0755);
+  }
+}
+
+std::string Preferences::keyPath(const char *key) const {
+  return sim::statePath("nvs/" + ns + "/" + key);
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition) {
+  sim::HalScope hal;
+  ns = name;
+  this->readOnly = readOnly;
+  makeDirs(sim::statePath("nvs/" + ns));
+  return true;
+}
+
+bool Preferences::isKey(const char *key) {
+  sim::HalScope hal;
+  struct stat st;
+  return !ns.empty() && stat(keyPath(key).c_str(), &st) == 0;
+}
+
+bool Preferences::remove(const char *key) {
+  sim::HalScope hal;
+  return !ns.empty() && !readOnly && unlink(keyPath(key).c_str()) == 0;
+}
+
+bool Preferences::clear() {
+  sim::HalScope hal;
+  if (ns.empty() || readOnly)
+    return false;
+  std::string dir = sim::statePath("nvs/" + ns);
+  DIR *d = opendir(dir.c_str());
+  if (!d)
+    return false;
+  while (dirent *e = readdir(d)) {
+    if (e->d_name[0] != '.')
+      unlink((dir + "/" + e->d_name).c_str());
+  }
+  closedir(d);
+  return true;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  sim::HalScope hal;
+  if (ns.empty() || readOnly)
+    return 0;
+  sim::advanceMs(2); // NVS page write
+  FILE *f = fopen(keyPath(key).c_str(), "wb");
+  if (!f)
+    return 0;
+  size_t n = fwrite(value, 1, len, f);
+  fclose(f);
+  return n;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  sim::HalScope hal;
+  struct stat st;
+  return !ns.empty() && stat(keyPath(key).c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  sim::HalScope hal;
+  if (ns.empty())
+    return 0;
+  FILE *f = fopen(keyPath(key).c_str(), "rb");
+  if (!f)
+    return 0;
+  size_t n = fread(buf, 1, maxLen, f);
+  fclose(f);
+  return n;
+}
@@ -0,0 +1,157 @@
+#include "sim.h"
+#include <SD.h>
+#include <sys/stat.h>
+
+SPIClass SPI;
+SDFS SD;
+
+// Rough SD-over-SPI costs: the clock SD.begin() asked for, a command per
+// transfer, the card's programming time per sector written, a read of any
+// existing sector a write only partly covers (FatFs read-modify-write),
+// and directory/FAT sector updates when a modified file is synced.
+static uint32_t spiHz = 4000000;
+static const uint32_t SECTOR = 512;
+static const uint32_t PROGRAM_US = 400;
+static const uint32_t OPEN_US = 1500; // path lookup
+
+static uint64_t transferUs(size_t bytes) {
+  return (uint64_t)bytes * 8 * 1000000 / spiHz + 200;
+}
+
+namespace fs {
+
+// ----- File -----
+File::File(FILE *f, const std::string &path)
+    : handle(f, [](FILE *fp) { fclose(fp); }), path(path) {}
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t *buf, size_t size) {
+  if (!handle || !size)
+    return 0;
+  size_t pos = position(), end = pos + size, fileSize = this->size();
+  size_t first = pos / SECTOR, last = (end - 1) / SECTOR;
+  uint64_t us = transferUs(size) + (last - first + 1) * PROGRAM_US;
+  bool headPartial = pos % SECTOR && first * SECTOR < fileSize;
+  bool tailPartial = end % SECTOR && last * SECTOR < fileSize &&
+                     !(headPartial && first == last);
+  us += (headPartial + tailPartial) * transferUs(SECTOR);
+  sim::advanceUs(us);
+  if (end > fileSize)
+    grown = true;
+  modified = true;
+  return fwrite(buf, 1, size, handle.get());
+}
+
+int File::available() {
+  if (!handle)
+    return 0;
+  return (int)(size() - position());
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!handle)
+    return -1;
+  int c = fgetc(handle.get());
+  if (c != EOF)
+    ungetc(c, handle.get());
+  return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+  if (!handle)
+    return 0;
+  sim::advanceUs(transferUs(size));
+  return fread(buf, 1, size, handle.get());
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  return handle && fseek(handle.get(), pos, mode) == 0;
+}
+
+size_t File::position() const {
+  if (!handle)
+    return 0;
+  long pos = ftell(handle.get());
+  return pos < 0 ? 0 : pos;
+}
+
+size_t File::size() const {
+  if (!handle)
+    return 0;
+  fflush(handle.get());
+  struct stat st;
+  return fstat(fileno(handle.get()), &st) == 0 ? st.st_size : 0;
+}
+
+void File::flush() {
+  if (!handle)
+    return;
+  fflush(handle.get());
+  if (modified) // directory entry, plus the FAT when the file grew
+    sim::advanceUs((1 + grown) * (transferUs(SECTOR) + PROGRAM_US));
+  modified = grown = false;
+}
+
+void File::close() {
+  flush();
+  handle.reset();
+}
+
+// ----- FS -----
+std::string FS::hostPath(const char *path) const {
+  return sim::statePath(subdir) + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char *path, const char *mode, bool create) {
+  sim::HalScope hal;
+  if (!mounted)
+    return File();
+  sim::advanceUs(OPEN_US);
+  std::string host = hostPath(path);
+  FILE *f = fopen(host.c_str(), mode);
+  if (!f && create && strcmp(mode, "r+") == 0)
+    f = fopen(host.c_str(), "w+");
+  return f ? File(f, path) : File();
+}
+
+bool FS::exists(const char *path) {
+  sim::HalScope hal;
+  struct stat st;
+  return mounted && stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+  sim::HalScope hal;
+  return mounted && ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+  sim::HalScope hal;
+  return mounted && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  sim::HalScope hal;
+  return mounted && ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+} // namespace fs
+
+// ----- SD -----
+bool SDFS::begin(uint8_t ssPin, SPIClass &spi, uint32_t frequency,
+                 const char *mountpoint, uint8_t max_files, bool format_if_empty) {
+  sim::HalScope hal;
+  sim::advanceMs(30); // card init
+  if (!sim::scenario().sd)
+    return false;
+  spiHz = frequency;
+  ::mkdir(sim::statePath("sd").c_str(), 0755);
+  mounted = true;
+  return true;
+}
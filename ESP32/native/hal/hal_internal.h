@@ -0,0 +1,22 @@
+#ifndef NATIVE_HAL_INTERNAL_H
+#define NATIVE_HAL_INTERNAL_H
+
+// Hooks between the mock HAL pieces; not seen by firmware sources.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sim {
+
+bool wifiConnected();
+
+// PMS7003 on UART2
+void pmsBegin();
+int pmsAvailable();
+int pmsRead();
+int pmsPeek();
+void pmsWrite(const uint8_t *buf, size_t size);
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,380 @@
+#include "hal_internal.h"
+#include "sim.h"
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+// TCP connections opened since the last request sample (see traceEnd)
+static uint8_t connectsSinceSample = 0;
+
+namespace sim {
+bool wifiConnected() { return WiFi.status() == WL_CONNECTED; }
+} // namespace sim
+
+// ----- WiFi -----
+void WiFiClass::emit(arduino_event_id_t event) {
+  for (int i = 0; i < nCallbacks; i++)
+    callbacks[i](event);
+}
+
+int WiFiClass::onEvent(WiFiEventCb cb, arduino_event_id_t event) {
+  if (nCallbacks < 4)
+    callbacks[nCallbacks++] = cb;
+  return nCallbacks;
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+                       IPAddress dns1, IPAddress dns2) {
+  staticIp = local_ip;
+  return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase,
+                             int32_t channel, const uint8_t *bssid, bool connect) {
+  // Events fire before begin() returns; the firmware waits on an event
+  // group, so the order it observes is the same as on the device.
+  if (!sim::scenario().wifi)
+    return WL_DISCONNECTED;
+  bool fast = channel > 0 && bssid;
+  sim::advanceMs(fast ? sim::scenario().wifiFastMs : sim::scenario().wifiScanMs);
+  if (!fast)
+    sim::advanceMs(staticIp ? 0 : 400); // DHCP
+  connected = true;
+  ip = staticIp ? IPAddress(staticIp) : IPAddress(192, 168, 1, 77);
+  emit(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  emit(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  return WL_CONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+  if (connected) {
+    connected = false;
+    emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  }
+  return true;
+}
+
+uint8_t WiFiClass::waitForConnectResult(unsigned long timeoutLength) {
+  if (!connected)
+    sim::advanceMs(timeoutLength);
+  return status();
+}
+
+// ----- WiFiClient -----
+int WiFiClient::connect(const char *host, uint16_t port) {
+  sim::HalScope hal;
+  stop();
+  if (!sim::wifiConnected())
+    return 0;
+  const sim::Scenario &sc = sim::scenario();
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return 0;
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(sc.serverPort);
+  inet_pton(AF_INET, sc.serverHost.c_str(), &addr.sin_addr);
+  if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    stop();
+    return 0;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  timeval tv = {10, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sim::advanceMs(sc.rttMs); // SYN / SYN-ACK
+  if (connectsSinceSample < UINT8_MAX)
+    connectsSinceSample++;
+  return 1;
+}
+
+int WiFiClientSecure::connect(const char *host, uint16_t port) {
+  if (!WiFiClient::connect(host, port))
+    return 0;
+  sim::advanceMs(sim::scenario().tlsMs);
+  return 1;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+  if (fd < 0)
+    return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(fd, buf + sent, size - sent, MSG_NOSIGNAL);
+    if (n <= 0)
+      break;
+    sent += n;
+  }
+  return sent;
+}
+
+int WiFiClient::available() {
+  int n = 0;
+  if (fd < 0 || ioctl(fd, FIONREAD, &n) != 0)
+    return 0;
+  return n;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::peek() {
+  uint8_t c;
+  if (fd < 0 || recv(fd, &c, 1, MSG_PEEK) != 1)
+    return -1;
+  return c;
+}
+
+// Blocks (in real time) until data arrives or the socket times out
+int WiFiClient::read(uint8_t *buf, size_t size) {
+  if (fd < 0)
+    return -1;
+  ssize_t n = recv(fd, buf, size, 0);
+  return n > 0 ? (int)n : -1;
+}
+
+void WiFiClient::stop() {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
+
+uint8_t WiFiClient::connected() {
+  if (fd < 0)
+    return 0;
+  // Peer closed if the socket is readable with nothing to read
+  pollfd p = {fd, POLLIN, 0};
+  if (poll(&p, 1, 0) > 0) {
+    char c;
+    if (recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0) {
+      stop();
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// ----- HTTPClient -----
+HTTPClient::~HTTPClient() {
+  sim::HalScope hal;
+  if (ownClient) {
+    ownClient->stop();
+    delete ownClient;
+  }
+}
+
+bool HTTPClient::parseUrl(const char *url) {
+  std::string u(url);
+  bool https = u.compare(0, 8, "https://") == 0;
+  size_t start = u.find("://");
+  start = start == std::string::npos ? 0 : start + 3;
+  size_t slash = u.find('/', start);
+  std::string hostPort = u.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+  path = slash == std::string::npos ? "/" : u.substr(slash);
+  size_t colon = hostPort.find(':');
+  host = hostPort.substr(0, colon);
+  port = colon == std::string::npos ? (https ? 443 : 80) : atoi(hostPort.c_str() + colon + 1);
+  return !host.empty();
+}
+
+bool HTTPClient::begin(const char *url) {
+  sim::HalScope hal;
+  if (!ownClient)
+    ownClient = strncmp(url, "https://", 8) == 0 ? new WiFiClientSecure() : new WiFiClient();
+  client = ownClient;
+  headers.clear();
+  return parseUrl(url);
+}
+
+bool HTTPClient::begin(WiFiClient &c, const char *url) {
+  sim::HalScope hal;
+  client = &c;
+  headers.clear();
+  return parseUrl(url);
+}
+
+void HTTPClient::end() {
+  sim::HalScope hal;
+  if (client && (!reuse || !keepAlive))
+    client->stop();
+  headers.clear();
+}
+
+bool HTTPClient::connected() { return client && client->connected(); }
+
+void HTTPClient::addHeader(const char *name, const char *value) {
+  sim::HalScope hal;
+  headers.push_back(std::string(name) + ": " + value);
+}
+
+bool HTTPClient::ensureConnected() {
+  if (!client)
+    return false;
+  if (client->connected())
+    return true;
+  return client->connect(host.c_str(), port);
+}
+
+size_t HTTPClient::sendHeader(const char *type, size_t size) {
+  std::string req = std::string(type) + " " + path + " HTTP/1.1\r\n";
+  req += "Host: " + host + "\r\n";
+  req += "User-Agent: ESP32HTTPClient\r\n";
+  req += reuse ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+  if (strcmp(type, "GET") != 0)
+    req += "Content-Length: " + std::to_string(size) + "\r\n";
+  for (const std::string &h : headers)
+    req += h + "\r\n";
+  req += "\r\n";
+  return client->write((const uint8_t *)req.data(), req.size()) == req.size()
+             ? req.size()
+             : 0;
+}
+
+int HTTPClient::readResponse() {
+  std::string head;
+  uint8_t c;
+  while (head.size() < 8192 && head.find("\r\n\r\n") == std::string::npos) {
+    if (client->read(&c, 1) != 1)
+      return HTTPC_ERROR_READ_TIMEOUT;
+    head += (char)c;
+  }
+  int code = 0;
+  if (sscanf(head.c_str(), "HTTP/1.%*d %d", &code) != 1)
+    return HTTPC_ERROR_CONNECTION_LOST;
+
+  long length = -1;
+  keepAlive = reuse && head.compare(0, 8, "HTTP/1.1") == 0;
+  size_t pos = head.find("\r\n") + 2;
+  while (pos < head.size()) {
+    size_t eol = head.find("\r\n", pos);
+    std::string line = head.substr(pos, eol - pos);
+    std::string lower = line;
+    for (char &ch : lower)
+      ch = tolower(ch);
+    if (lower.compare(0, 15, "content-length:") == 0)
+      length = atol(line.c_str() + 15);
+    else if (lower.compare(0, 11, "connection:") == 0)
+      keepAlive = reuse && lower.find("close") == std::string::npos;
+    pos = eol + 2;
+  }
+
+  response.clear();
+  uint8_t buf[1024];
+  while (length < 0 || (long)response.size() < length) {
+    size_t want = length < 0 ? sizeof(buf) : std::min(sizeof(buf), (size_t)(length - response.size()));
+    int n = client->read(buf, want);
+    if (n <= 0)
+      break;
+    response.append((const char *)buf, n);
+  }
+  if (length < 0)
+    keepAlive = false; // body ended by close
+  sim::advanceMs(sim::scenario().rttMs);
+  return code;
+}
+
+// ----- REQUEST LOG -----
+// One sample per request for the fleet runner (sim::logRequest). Only real
+// time is measured here; the simulated round trip is in the wall clock.
+namespace {
+struct RequestTrace {
+  timespec start;
+  uint64_t wallUs;
+  size_t sent;
+};
+} // namespace
+
+static RequestTrace traceStart() {
+  RequestTrace t;
+  clock_gettime(CLOCK_MONOTONIC, &t.start);
+  t.wallUs = sim::wallClockUs();
+  t.sent = 0;
+  return t;
+}
+
+static int traceEnd(const RequestTrace &t, const std::string &path, int code,
+                    size_t received) {
+  const sim::Scenario &sc = sim::scenario();
+  if (sc.requestLog.empty())
+    return code;
+  timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  sim::RequestSample r = {};
+  r.wallUs = t.wallUs;
+  r.device = sc.device;
+  r.realUs = (end.tv_sec - t.start.tv_sec) * 1000000 +
+             (end.tv_nsec - t.start.tv_nsec) / 1000;
+  r.sentBytes = t.sent;
+  r.recvBytes = code > 0 ? received : 0;
+  r.code = code;
+  r.connects = connectsSinceSample; // including ones opened ahead of it
+  connectsSinceSample = 0;
+  size_t len = std::min(path.find('?'), sizeof(r.path) - 1);
+  memcpy(r.path, path.data(), std::min(len, path.size()));
+  sim::logRequest(r);
+  return code;
+}
+
+int HTTPClient::GET() { return sendRequest("GET", (const uint8_t *)nullptr, 0); }
+
+int HTTPClient::POST(const uint8_t *payload, size_t size) {
+  return sendRequest("POST", payload, size);
+}
+
+int HTTPClient::POST(const String &payload) {
+  return sendRequest("POST", (const uint8_t *)payload.c_str(), payload.length());
+}
+
+int HTTPClient::sendRequest(const char *type, const uint8_t *payload, size_t size) {
+  sim::HalScope hal;
+  RequestTrace trace = traceStart();
+  if (!ensureConnected())
+    return traceEnd(trace, path, HTTPC_ERROR_CONNECTION_REFUSED, 0);
+  if (!(trace.sent = sendHeader(type, size)))
+    return traceEnd(trace, path, HTTPC_ERROR_SEND_PAYLOAD_FAILED, 0);
+  if (size && client->write(payload, size) != size)
+    return traceEnd(trace, path, HTTPC_ERROR_SEND_PAYLOAD_FAILED, 0);
+  trace.sent += size;
+  int code = readResponse();
+  return traceEnd(trace, path, code, response.size());
+}
+
+int HTTPClient::sendRequest(const char *type, Stream *stream, size_t size) {
+  // Not a HalScope for the whole call: the body comes from firmware code
+  RequestTrace trace = traceStart();
+  {
+    sim::HalScope hal;
+    if (!ensureConnected())
+      return traceEnd(trace, path, HTTPC_ERROR_CONNECTION_REFUSED, 0);
+    if (!(trace.sent = sendHeader(type, size)))
+      return traceEnd(trace, path, HTTPC_ERROR_SEND_PAYLOAD_FAILED, 0);
+  }
+  uint8_t buf[1460];
+  size_t sent = 0;
+  while (sent < size) {
+    size_t n = 0;
+    int c;
+    while (n < sizeof(buf) && sent + n < size && (c = stream->read()) >= 0)
+      buf[n++] = (uint8_t)c;
+    if (!n || client->write(buf, n) != n)
+      return traceEnd(trace, path, HTTPC_ERROR_SEND_PAYLOAD_FAILED, 0);
+    sent += n;
+  }
+  sim::HalScope hal;
+  trace.sent += sent;
+  int code = readResponse();
+  return traceEnd(trace, path, code, response.size());
+}
@@ -0,0 +1,79 @@
+#include "sim.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Bounds of the rtc_data section, provided by the GNU linker
+extern char __start_rtc_data[] __attribute__((weak));
+extern char __stop_rtc_data[] __attribute__((weak));
+
+namespace sim {
+
+static Scenario currentScenario;
+static uint64_t virtualUs = 0;
+static uint64_t bootWallClockUs = 0;
+static uint32_t cycle = 0;
+
+Scenario &scenario() { return currentScenario; }
+
+uint64_t nowUs() { return virtualUs; }
+void advanceUs(uint64_t us) { virtualUs += us; }
+
+uint64_t wallClockUs() { return bootWallClockUs + virtualUs; }
+void setBootWallClockUs(uint64_t us) { bootWallClockUs = us; }
+
+uint32_t cycleIndex() { return cycle; }
+void setCycleIndex(uint32_t c) { cycle = c; }
+
+std::string statePath(const std::string &rel) {
+  return currentScenario.stateDir + "/" + rel;
+}
+
+size_t rtcMemorySize() {
+  if (!__start_rtc_data || !__stop_rtc_data)
+    return 0;
+  return __stop_rtc_data - __start_rtc_data;
+}
+
+bool loadRtcMemory(const std::string &path) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return false; // first boot: keep the image's initial values
+  size_t n = fread(__start_rtc_data, 1, rtcMemorySize(), f);
+  fclose(f);
+  return n == rtcMemorySize();
+}
+
+bool saveRtcMemory(const std::string &path) {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f)
+    return false;
+  size_t n = fwrite(__start_rtc_data, 1, rtcMemorySize(), f);
+  fclose(f);
+  return n == rtcMemorySize();
+}
+
+void logRequest(const RequestSample &sample) {
+  static int fd = -1;
+  if (fd < 0)
+    fd = open(currentScenario.requestLog.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd >= 0 && write(fd, &sample, sizeof(sample)) != (ssize_t)sizeof(sample))
+    perror("request log");
+}
+
+void deepSleep(uint64_t sleepUs) {
+  HalScope hal;
+  fflush(stdout);
+  printAllocSites(2);
+  saveRtcMemory(statePath("rtc_memory.bin"));
+  FILE *f = fopen(statePath("sleep.bin").c_str(), "wb");
+  if (f) {
+    uint64_t v[3] = {virtualUs, sleepUs, allocCount()};
+    fwrite(v, sizeof(v), 1, f);
+    fclose(f);
+  }
+  _exit(0);
+}
+
+} // namespace sim
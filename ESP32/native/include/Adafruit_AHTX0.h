@@ -0,0 +1,20 @@
+#ifndef NATIVE_ADAFRUIT_AHTX0_H
+#define NATIVE_ADAFRUIT_AHTX0_H
+
+// ----- MOCK AHT20 (native build) -----
+// Reports Scenario::temp / Scenario::hum.
+
+#include <Arduino.h>
+
+typedef struct {
+  float temperature;
+  float relative_humidity;
+} sensors_event_t;
+
+class Adafruit_AHTX0 {
+public:
+  bool begin();
+  bool getEvent(sensors_event_t *humidity, sensors_event_t *temp);
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// ----- MOCK ARDUINO CORE (native build) -----
+// Just enough of the ESP32 Arduino core for the firmware sources to build
+// and run on Linux. Time is virtual: delay() advances the clock instead of
+// sleeping, so a 30-minute cycle runs in milliseconds.
+
+#include <algorithm>
+#include <cmath>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F(x) (x)
+#define PROGMEM
+#define IRAM_ATTR
+// RTC slow memory: carried across simulated deep sleep by the runner
+#define RTC_DATA_ATTR __attribute__((section("rtc_data")))
+
+using std::abs;
+using std::isnan;
+using std::max;
+using std::min;
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// ----- ADC -----
+enum adc_attenuation_t { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+int analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void analogSetPinAttenuation(uint8_t pin, adc_attenuation_t attenuation);
+
+// ----- TIME / SYSTEM -----
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+void configTime(long gmtOffset_sec, int daylightOffset_sec,
+                const char *server1, const char *server2 = nullptr,
+                const char *server3 = nullptr);
+uint32_t esp_random();
+
+// ----- String -----
+class String {
+public:
+  String() {}
+  String(const char *s) : s(s ? s : "") {}
+  String(const std::string &s) : s(s) {}
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  bool concat(const char *x) { s += x; return true; }
+  bool concat(char c) { s += c; return true; }
+  String &operator+=(const char *x) { s += x; return *this; }
+  String &operator+=(char c) { s += c; return *this; }
+  char operator[](unsigned int i) const { return s[i]; }
+  bool reserve(unsigned int n) { s.reserve(n); return true; }
+  void trim();
+  void toCharArray(char *buf, unsigned int size) const;
+
+private:
+  std::string s;
+};
+
+// ----- Print / Stream -----
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size);
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { return print(v) + println(); }
+  size_t println(double v, int digits) { return print(v, digits) + println(); }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long ms) { timeout = ms; }
+  size_t readBytes(uint8_t *buf, size_t length);
+  size_t readBytes(char *buf, size_t length) { return readBytes((uint8_t *)buf, length); }
+  size_t readBytesUntil(char terminator, char *buf, size_t length);
+  String readStringUntil(char terminator);
+
+protected:
+  unsigned long timeout = 1000;
+  int timedRead();
+};
+
+// ----- HardwareSerial -----
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(int uart) : uart(uart) {}
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx = -1,
+             int8_t tx = -1);
+  void end() {}
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  void flush() override;
+
+private:
+  int uart;
+};
+
+extern HardwareSerial Serial;
+
+#endif
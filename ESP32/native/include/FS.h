@@ -0,0 +1,66 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+// ----- MOCK FS (native build) -----
+// Files map onto a host directory (see SD.h).
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+public:
+  File() {}
+  File(FILE *f, const std::string &path);
+
+  explicit operator bool() const { return (bool)handle; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t *buf, size_t size);
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void flush() override;
+  void close();
+  const char *name() const { return path.c_str(); }
+  bool isDirectory() const { return false; }
+
+private:
+  std::shared_ptr<FILE> handle;
+  std::string path;
+  bool modified = false, grown = false; // since the last flush()
+};
+
+class FS {
+public:
+  explicit FS(const char *subdir) : subdir(subdir) {}
+  File open(const char *path, const char *mode = FILE_READ, bool create = false);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *path);
+
+protected:
+  bool mounted = false;
+  std::string hostPath(const char *path) const;
+
+private:
+  const char *subdir;
+};
+
+} // namespace fs
+
+using fs::File;
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef NATIVE_HTTPCLIENT_H
+#define NATIVE_HTTPCLIENT_H
+
+// ----- MOCK HTTPClient (native build) -----
+// HTTP/1.1 over the mock WiFiClient, with keep-alive when setReuse(true).
+// Each request is charged Scenario::rttMs of virtual time.
+
+#include <WiFiClient.h>
+#include <string>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient {
+public:
+  ~HTTPClient();
+  bool begin(const char *url);
+  bool begin(WiFiClient &client, const char *url);
+  void end();
+  void setReuse(bool reuse) { this->reuse = reuse; }
+  void setTimeout(uint16_t timeout) {}
+  void setConnectTimeout(int32_t timeout) {}
+  void addHeader(const char *name, const char *value);
+
+  int GET();
+  int POST(const uint8_t *payload, size_t size);
+  int POST(const String &payload);
+  int sendRequest(const char *type, const uint8_t *payload, size_t size);
+  int sendRequest(const char *type, Stream *stream, size_t size);
+  String getString() { return String(response); }
+  bool connected();
+
+private:
+  WiFiClient *client = nullptr;
+  WiFiClient *ownClient = nullptr;
+  bool reuse = false;
+  bool keepAlive = false;
+  std::string host, path;
+  uint16_t port = 80;
+  std::vector<std::string> headers;
+  std::string response;
+
+  bool parseUrl(const char *url);
+  bool ensureConnected();
+  size_t sendHeader(const char *type, size_t size); // bytes sent, 0 on error
+  int readResponse();
+};
+
+#endif
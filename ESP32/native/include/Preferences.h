@@ -0,0 +1,39 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+// ----- MOCK NVS Preferences (native build) -----
+// One file per key under <stateDir>/nvs/<namespace>/.
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partition = nullptr);
+  void end() { ns.clear(); }
+  bool isKey(const char *key);
+  bool remove(const char *key);
+  bool clear();
+
+  size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putInt(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putFloat(const char *key, float value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putBytes(const char *key, const void *value, size_t len);
+
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+  int32_t getInt(const char *key, int32_t defaultValue = 0) { return get(key, defaultValue); }
+  float getFloat(const char *key, float defaultValue = NAN) { return get(key, defaultValue); }
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+  std::string ns;
+  bool readOnly = false;
+  std::string keyPath(const char *key) const;
+
+  template <typename T> T get(const char *key, T defaultValue) {
+    T v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+  }
+};
+
+#endif
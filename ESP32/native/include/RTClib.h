@@ -0,0 +1,47 @@
+#ifndef NATIVE_RTCLIB_H
+#define NATIVE_RTCLIB_H
+
+// ----- MOCK RTClib (native build) -----
+// DS3231 runs off the simulated wall clock with Scenario::rtcDriftPpm of
+// drift. Its setting survives cycles (it has its own coin cell) in
+// <stateDir>/ds3231.bin.
+
+#include <Arduino.h>
+
+class DateTime {
+public:
+  DateTime(uint32_t t = 0);
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0,
+           uint8_t min = 0, uint8_t sec = 0);
+  uint16_t year() const { return yOff + 2000; }
+  uint8_t month() const { return m; }
+  uint8_t day() const { return d; }
+  uint8_t hour() const { return hh; }
+  uint8_t minute() const { return mm; }
+  uint8_t second() const { return ss; }
+  uint32_t unixtime() const;
+
+private:
+  uint8_t yOff = 0, m = 1, d = 1, hh = 0, mm = 0, ss = 0;
+};
+
+enum Ds3231Alarm1Mode { DS3231_A1_PerSecond, DS3231_A1_Second, DS3231_A1_Minute,
+                        DS3231_A1_Hour, DS3231_A1_Date, DS3231_A1_Day };
+
+class RTC_DS3231 {
+public:
+  bool begin();
+  bool lostPower();
+  DateTime now();
+  void adjust(const DateTime &dt);
+  float getTemperature() { return 25.0f; }
+  bool setAlarm1(const DateTime &dt, Ds3231Alarm1Mode mode) { return true; }
+  void clearAlarm(uint8_t n) {}
+  bool alarmFired(uint8_t n) { return false; }
+  void disable32K() {}
+  void writeSqwPinMode(int mode) {}
+};
+
+#define DS3231_OFF 0x1C
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef NATIVE_SD_H
+#define NATIVE_SD_H
+
+// ----- MOCK SD (native build) -----
+// The card is <stateDir>/sd; Scenario::sd decides whether it mounts.
+
+#include <FS.h>
+#include <SPI.h>
+
+class SDFS : public fs::FS {
+public:
+  SDFS() : fs::FS("sd") {}
+  bool begin(uint8_t ssPin = 5, SPIClass &spi = SPI, uint32_t frequency = 4000000,
+             const char *mountpoint = "/sd", uint8_t max_files = 5,
+             bool format_if_empty = false);
+  void end() { mounted = false; }
+};
+
+extern SDFS SD;
+
+#endif
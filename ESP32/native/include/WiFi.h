@@ -0,0 +1,76 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+// ----- MOCK WiFi (native build) -----
+// Association always "works" unless Scenario::wifi is false. The time a
+// real connect would take is charged to the virtual clock: wifiFastMs when
+// a BSSID and channel are given, wifiScanMs otherwise.
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+  ARDUINO_EVENT_MAX = 100,
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint32_t addr) : addr(addr) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : addr(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+  operator uint32_t() const { return addr; }
+
+private:
+  uint32_t addr = 0;
+};
+
+class WiFiClass {
+public:
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr,
+                    int32_t channel = 0, const uint8_t *bssid = nullptr,
+                    bool connect = true);
+  bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+              IPAddress dns1 = (uint32_t)0, IPAddress dns2 = (uint32_t)0);
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+  bool mode(wifi_mode_t m) { return true; }
+  void persistent(bool p) {}
+  int onEvent(WiFiEventCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+  wl_status_t status() { return connected ? WL_CONNECTED : WL_DISCONNECTED; }
+  uint8_t waitForConnectResult(unsigned long timeoutLength = 60000);
+
+  uint8_t *BSSID() { return bssid; }
+  int32_t channel() { return 6; }
+  int32_t RSSI() { return -61; }
+  IPAddress localIP() { return connected ? ip : IPAddress(); }
+  IPAddress gatewayIP() { return IPAddress(192, 168, 1, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP(uint8_t n = 0) { return IPAddress(192, 168, 1, 1); }
+
+private:
+  bool connected = false;
+  uint32_t staticIp = 0;
+  IPAddress ip;
+  uint8_t bssid[6] = {0x24, 0x0a, 0xc4, 0x11, 0x22, 0x33};
+  WiFiEventCb callbacks[4] = {};
+  int nCallbacks = 0;
+  void emit(arduino_event_id_t event);
+};
+
+extern WiFiClass WiFi;
+
+#endif
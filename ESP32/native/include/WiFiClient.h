@@ -0,0 +1,33 @@
+#ifndef NATIVE_WIFICLIENT_H
+#define NATIVE_WIFICLIENT_H
+
+// ----- MOCK WiFiClient (native build) -----
+// A real TCP socket. Whatever host is asked for, the connection goes to
+// Scenario::serverHost:serverPort, the local ingest stand-in.
+
+#include <Arduino.h>
+
+class WiFiClient : public Stream {
+public:
+  WiFiClient() {}
+  WiFiClient(const WiFiClient &) = delete;
+  WiFiClient &operator=(const WiFiClient &) = delete;
+  virtual ~WiFiClient() { stop(); }
+
+  virtual int connect(const char *host, uint16_t port);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  int read(uint8_t *buf, size_t size);
+  virtual void stop();
+  uint8_t connected();
+  void setTimeout(uint32_t seconds) { Stream::setTimeout(seconds * 1000); }
+
+protected:
+  int fd = -1;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef NATIVE_WIFICLIENTSECURE_H
+#define NATIVE_WIFICLIENTSECURE_H
+
+// ----- MOCK WiFiClientSecure (native build) -----
+// Plain TCP underneath; each new connection is charged Scenario::tlsMs of
+// virtual time to stand in for the handshake.
+
+#include <WiFiClient.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+  int connect(const char *host, uint16_t port) override;
+  void setInsecure() {}
+  void setHandshakeTimeout(unsigned long seconds) {}
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef NATIVE_DRIVER_ADC_H
+#define NATIVE_DRIVER_ADC_H
+
+// ----- MOCK ADC1 ONE-SHOT DRIVER (native build) -----
+// Channel 0 (GPIO36) reads Scenario::adc1 and channel 7 (GPIO35)
+// Scenario::adc2, with a little noise and an occasional spike. Each
+// conversion costs 40 µs of virtual time.
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef enum {
+  ADC1_CHANNEL_0 = 0,
+  ADC1_CHANNEL_1,
+  ADC1_CHANNEL_2,
+  ADC1_CHANNEL_3,
+  ADC1_CHANNEL_4,
+  ADC1_CHANNEL_5,
+  ADC1_CHANNEL_6,
+  ADC1_CHANNEL_7,
+} adc1_channel_t;
+
+typedef enum {
+  ADC_ATTEN_DB_0 = 0,
+  ADC_ATTEN_DB_2_5,
+  ADC_ATTEN_DB_6,
+  ADC_ATTEN_DB_11,
+} adc_atten_t;
+
+typedef enum {
+  ADC_WIDTH_BIT_9 = 0,
+  ADC_WIDTH_BIT_10,
+  ADC_WIDTH_BIT_11,
+  ADC_WIDTH_BIT_12,
+} adc_bits_width_t;
+
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+
+esp_err_t adc1_config_width(adc_bits_width_t width);
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten);
+int adc1_get_raw(adc1_channel_t channel);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef NATIVE_ESP_SNTP_H
+#define NATIVE_ESP_SNTP_H
+
+// SNTP completes Scenario::ntpMs after configTime() while WiFi is up.
+// COMPLETED is reported once per sync, as in ESP-IDF's immediate mode.
+typedef enum {
+  SNTP_SYNC_STATUS_RESET,
+  SNTP_SYNC_STATUS_COMPLETED,
+  SNTP_SYNC_STATUS_IN_PROGRESS,
+} sntp_sync_status_t;
+
+sntp_sync_status_t sntp_get_sync_status();
+
+#endif
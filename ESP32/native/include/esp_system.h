@@ -0,0 +1,13 @@
+#ifndef NATIVE_ESP_SYSTEM_H
+#define NATIVE_ESP_SYSTEM_H
+
+// ----- MOCK HEAP STATS (native build) -----
+// Derived from the host allocator against a 320 KB device heap, so the
+// numbers move with what the firmware actually allocates.
+
+#include <stdint.h>
+
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
+
+#endif
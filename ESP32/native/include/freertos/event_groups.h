@@ -0,0 +1,24 @@
+#ifndef NATIVE_FREERTOS_EVENT_GROUPS_H
+#define NATIVE_FREERTOS_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct NativeEventGroup *EventGroupHandle_t;
+
+typedef struct {
+  uint32_t opaque[8];
+} StaticEventGroup_t;
+
+EventGroupHandle_t xEventGroupCreate();
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *buffer);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+// Returns at once; if the bits are not set, the timeout is charged to the
+// virtual clock as if the wait had expired.
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clearOnExit, BaseType_t waitForAll,
+                                TickType_t ticks);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core);
+// Stack depth is in bytes on the ESP32 port, as in the real headers
+typedef uint8_t StackType_t;
+typedef struct {
+  uint32_t opaque[88];
+} StaticTask_t;
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name,
+                                           uint32_t stackDepth, void *param,
+                                           UBaseType_t priority, StackType_t *stack,
+                                           StaticTask_t *tcb, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+// Tasks run inline, so a task suspending itself just returns to its creator
+void vTaskSuspend(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+
+#endif
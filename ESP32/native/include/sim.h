@@ -0,0 +1,107 @@
+#ifndef SIM_H
+#define SIM_H
+
+// ----- NATIVE SIMULATION CONTROL -----
+// Shared between the mock HAL and the native runner. Each wake cycle runs
+// in a forked child with fresh .data/.bss; RTC_DATA_ATTR variables live in
+// the "rtc_data" section, which the runner carries from one child to the
+// next, just like RTC slow memory across deep sleep.
+
+#include <stdint.h>
+#include <string>
+
+namespace sim {
+
+// What the outside world looks like during one wake. Values can change
+// between cycles through the runner's --script file.
+struct Scenario {
+  float temp = 22.5f;      // AHT20 °C
+  float hum = 55.0f;       // AHT20 %RH
+  int pm1 = 8, pm25 = 12, pm10 = 15; // PMS7003 atmospheric µg/m³
+  int adc1 = 1375;         // raw 12-bit counts on ADC_PIN1 (Vin)
+  int adc2 = 1070;         // raw 12-bit counts on ADC_PIN2 (battery)
+  bool wifi = true;        // AP reachable
+  bool sd = true;          // card present
+  bool aht = true;         // AHT20 answers on I2C
+  bool rtc = true;         // DS3231 answers on I2C
+  bool pms = true;         // PMS7003 streams frames
+
+  uint32_t wifiScanMs = 2500; // full scan + DHCP
+  uint32_t wifiFastMs = 350;  // cached BSSID/channel/static IP
+  uint32_t ntpMs = 250;
+  uint32_t tlsMs = 900;       // handshake cost added per WiFiClientSecure connect
+  uint32_t rttMs = 120;       // added per HTTP request
+  uint32_t pmsSettleMs = 6000; // PMS readings wander this long after wake-up
+  float rtcDriftPpm = 0;      // DS3231 drift
+  float sleepTimerPpm = 0;    // ESP32 deep-sleep timer error (+ sleeps long)
+  int rtcOffsetS = 0;         // DS3231 error when first powered (fresh state only)
+  std::string console;        // typed on the serial console (one wake only)
+  bool pmsHasCapture = false;
+  std::string pmsCapture;     // replay these bytes instead of synthesised frames
+
+  std::string serverHost = "127.0.0.1"; // every HTTP host maps here
+  uint16_t serverPort = 8000;
+  std::string stateDir = "native_state"; // sd/, nvs/, ds3231.bin
+  uint32_t device = 0;        // fleet runner: which simulated unit this is
+  std::string requestLog;     // append a RequestSample per HTTP request here
+};
+
+Scenario &scenario();
+
+// Virtual time since this wake started
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+inline void advanceMs(uint32_t ms) { advanceUs((uint64_t)ms * 1000); }
+
+// True UTC time in the simulated world
+uint64_t wallClockUs();
+void setBootWallClockUs(uint64_t us);
+
+uint32_t cycleIndex();
+void setCycleIndex(uint32_t cycle);
+
+// Saves RTC memory and the requested sleep for the runner, then ends the
+// child process. Called by esp_deep_sleep_start().
+[[noreturn]] void deepSleep(uint64_t sleepUs);
+
+// Runner side: move RTC memory in and out of this process' rtc_data section
+bool loadRtcMemory(const std::string &path);
+bool saveRtcMemory(const std::string &path);
+size_t rtcMemorySize();
+
+std::string statePath(const std::string &rel);
+
+// ----- REQUEST LOG -----
+// With Scenario::requestLog set, every HTTP request the firmware makes is
+// appended to that file as one fixed-size record. Many wake processes can
+// share the file: each sample is a single O_APPEND write.
+struct RequestSample {
+  uint64_t wallUs;    // simulated UTC time the request started
+  uint32_t device;    // Scenario::device
+  uint32_t realUs;    // real time against the server, connect included
+  uint32_t sentBytes; // request line, headers and body
+  uint32_t recvBytes; // response body
+  int16_t code;       // HTTP status, or a negative HTTPC_ERROR_*
+  uint8_t connects;   // TCP connections opened since the previous request
+  uint8_t reserved;
+  char path[40];      // without the query string
+};
+
+void logRequest(const RequestSample &sample);
+
+// ----- ALLOCATION CHECK -----
+// Every operator new made by firmware code during a wake is counted; the
+// mock HAL's own bookkeeping (paths, sockets, HTTP framing) is excluded by
+// holding a HalScope. The first few call stacks are kept for the report.
+struct HalScope {
+  HalScope();
+  ~HalScope();
+};
+
+void allocCheckStart();
+uint32_t allocCount();
+void printAllocSites(int fd);
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,271 @@
+// ----- NATIVE RUNNER -----
+// Runs the unmodified firmware on the host for N wake cycles. Each cycle
+// is a fork()ed child that restores RTC memory, calls setup() and ends in
+// esp_deep_sleep_start(); the parent then advances the simulated wall
+// clock by the time spent awake plus the requested sleep.
+//
+//   .pio/build/native/program --cycles 48 --server 127.0.0.1:8000
+//   .pio/build/native/program --cycles 12 --script outage.csv
+//   .pio/build/native/program --cycles 8 --check-alloc
+//
+// --console sends a line to the firmware's serial console during the
+// first cycle, e.g. --console "cal bat 4.12".
+//
+// --check-alloc fails the run if firmware code touched the heap during a
+// wake (allocations made inside the mock HAL are not counted).
+//
+// A script is a CSV whose header names Scenario fields (cycle first);
+// each row applies from its cycle onwards, e.g.
+//   cycle,wifi,pm25
+//   10,0,40
+//   20,1,12
+//
+// sleepTimerPpm makes deep sleep run long (or short, if negative) like the
+// ESP32's RC slow clock, to watch the wake schedule stay on its slots.
+// rtcOffsetS sets the DS3231 that far off on a fresh state directory.
+//
+// fleet/fleet_native.cpp runs many units at once against one server.
+
+#include "sim.h"
+#include <Arduino.h>
+#include <map>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+void setup();
+void loop();
+
+struct RunnerState {
+  uint64_t bootWallUs;
+  uint32_t cycle;
+};
+
+typedef std::map<std::string, std::string> ScriptRow;
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--cycles N] [--state DIR] [--server HOST:PORT]\n"
+          "          [--script FILE.csv] [--pms-capture FILE] [--fresh]\n"
+          "          [--console TEXT] [--check-alloc]\n",
+          argv0);
+  exit(2);
+}
+
+static bool setField(sim::Scenario &sc, const std::string &key, const std::string &v) {
+  std::map<std::string, float *> floats = {
+      {"temp", &sc.temp}, {"hum", &sc.hum}, {"rtcDriftPpm", &sc.rtcDriftPpm},
+      {"sleepTimerPpm", &sc.sleepTimerPpm}};
+  std::map<std::string, int *> ints = {
+      {"pm1", &sc.pm1}, {"pm25", &sc.pm25}, {"pm10", &sc.pm10},
+      {"adc1", &sc.adc1}, {"adc2", &sc.adc2}, {"rtcOffsetS", &sc.rtcOffsetS}};
+  std::map<std::string, bool *> bools = {
+      {"wifi", &sc.wifi}, {"sd", &sc.sd}, {"aht", &sc.aht},
+      {"rtc", &sc.rtc}, {"pms", &sc.pms}};
+  std::map<std::string, uint32_t *> durations = {
+      {"wifiScanMs", &sc.wifiScanMs}, {"wifiFastMs", &sc.wifiFastMs},
+      {"ntpMs", &sc.ntpMs}, {"tlsMs", &sc.tlsMs}, {"rttMs", &sc.rttMs},
+      {"pmsSettleMs", &sc.pmsSettleMs}};
+  if (floats.count(key))
+    *floats[key] = atof(v.c_str());
+  else if (ints.count(key))
+    *ints[key] = atoi(v.c_str());
+  else if (bools.count(key))
+    *bools[key] = atoi(v.c_str()) != 0;
+  else if (durations.count(key))
+    *durations[key] = strtoul(v.c_str(), nullptr, 10);
+  else
+    return false;
+  return true;
+}
+
+static std::vector<ScriptRow> loadScript(const char *path) {
+  std::vector<ScriptRow> rows;
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "cannot open script %s\n", path);
+    exit(1);
+  }
+  std::vector<std::string> columns;
+  char line[1024];
+  while (fgets(line, sizeof(line), f)) {
+    std::string s(line);
+    s.erase(s.find_last_not_of("\r\n") + 1);
+    if (s.empty() || s[0] == '#')
+      continue;
+    std::vector<std::string> cells;
+    std::stringstream ss(s);
+    std::string cell;
+    while (std::getline(ss, cell, ','))
+      cells.push_back(cell);
+    if (columns.empty()) {
+      columns = cells;
+      continue;
+    }
+    ScriptRow row;
+    for (size_t i = 0; i < cells.size() && i < columns.size(); i++) {
+      if (!cells[i].empty())
+        row[columns[i]] = cells[i];
+    }
+    rows.push_back(row);
+  }
+  fclose(f);
+  return rows;
+}
+
+static bool loadRunnerState(RunnerState &rs) {
+  FILE *f = fopen(sim::statePath("runner.bin").c_str(), "rb");
+  if (!f)
+    return false;
+  bool ok = fread(&rs, sizeof(rs), 1, f) == 1;
+  fclose(f);
+  return ok;
+}
+
+static void saveRunnerState(const RunnerState &rs) {
+  FILE *f = fopen(sim::statePath("runner.bin").c_str(), "wb");
+  if (f) {
+    fwrite(&rs, sizeof(rs), 1, f);
+    fclose(f);
+  }
+}
+
+// Child side of one wake cycle; never returns.
+static void runCycle(const RunnerState &rs) {
+  sim::setCycleIndex(rs.cycle);
+  sim::setBootWallClockUs(rs.bootWallUs);
+  sim::loadRtcMemory(sim::statePath("rtc_memory.bin"));
+  sim::allocCheckStart();
+  setup();
+  // The firmware sleeps at the end of setup(); give loop() a bounded chance
+  for (int i = 0; i < 1000; i++)
+    loop();
+  fprintf(stderr, "cycle %u never went to deep sleep\n", rs.cycle);
+  fflush(stdout);
+  _exit(3);
+}
+
+int main(int argc, char **argv) {
+  sim::Scenario &sc = sim::scenario();
+  uint32_t cycles = 1;
+  const char *script = nullptr;
+  bool fresh = false;
+  bool checkAlloc = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--cycles" && hasValue) {
+      cycles = strtoul(argv[++i], nullptr, 10);
+    } else if (a == "--state" && hasValue) {
+      sc.stateDir = argv[++i];
+    } else if (a == "--server" && hasValue) {
+      std::string hp = argv[++i];
+      size_t colon = hp.find(':');
+      sc.serverHost = hp.substr(0, colon);
+      if (colon != std::string::npos)
+        sc.serverPort = atoi(hp.c_str() + colon + 1);
+    } else if (a == "--script" && hasValue) {
+      script = argv[++i];
+    } else if (a == "--pms-capture" && hasValue) {
+      sc.pmsCapture = argv[++i];
+      sc.pmsHasCapture = true;
+    } else if (a == "--console" && hasValue) {
+      sc.console = std::string(argv[++i]) + "\n";
+    } else if (a == "--fresh") {
+      fresh = true;
+    } else if (a == "--check-alloc") {
+      checkAlloc = true;
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  // The ESP32 starts in UTC until configTime() sets a zone
+  setenv("TZ", "UTC0", 1);
+  tzset();
+
+  if (fresh) {
+    std::string cmd = "rm -rf '" + sc.stateDir + "'";
+    if (system(cmd.c_str()) != 0)
+      return 1;
+  }
+  mkdir(sc.stateDir.c_str(), 0755);
+
+  std::vector<ScriptRow> rows;
+  if (script)
+    rows = loadScript(script);
+
+  RunnerState rs;
+  if (!loadRunnerState(rs)) {
+    rs.bootWallUs = (uint64_t)time(nullptr) * 1000000;
+    rs.cycle = 0;
+  }
+
+  uint64_t totalAwakeUs = 0;
+  uint64_t totalAllocs = 0;
+  for (uint32_t n = 0; n < cycles; n++, rs.cycle++) {
+    for (const ScriptRow &row : rows) {
+      auto c = row.find("cycle");
+      if (c == row.end() || strtoul(c->second.c_str(), nullptr, 10) != rs.cycle)
+        continue;
+      for (const auto &kv : row) {
+        if (kv.first != "cycle" && !setField(sc, kv.first, kv.second))
+          fprintf(stderr, "script: unknown field '%s'\n", kv.first.c_str());
+      }
+    }
+
+    unlink(sim::statePath("sleep.bin").c_str());
+    time_t boot = rs.bootWallUs / 1000000;
+    struct tm bt;
+    gmtime_r(&boot, &bt);
+    printf("\n===== cycle %u, %04d-%02d-%02d %02d:%02d:%02d.%03u UTC =====\n",
+           rs.cycle, bt.tm_year + 1900, bt.tm_mon + 1, bt.tm_mday, bt.tm_hour,
+           bt.tm_min, bt.tm_sec, (unsigned)(rs.bootWallUs / 1000 % 1000));
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0)
+      runCycle(rs);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    uint64_t slept[3] = {0, 0, 0}; // awake us, sleep us, heap allocations
+    FILE *f = fopen(sim::statePath("sleep.bin").c_str(), "rb");
+    bool ok = f && fread(slept, sizeof(slept), 1, f) == 1;
+    if (f)
+      fclose(f);
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "cycle %u crashed (status 0x%x)\n", rs.cycle, status);
+      return 1;
+    }
+
+    sc.console.clear(); // typed once
+    totalAwakeUs += slept[0];
+    totalAllocs += slept[2];
+    printf("----- cycle %u: awake %.2f s, sleeping %.0f s, %u heap allocation(s) -----\n",
+           rs.cycle, slept[0] / 1e6, slept[1] / 1e6, (unsigned)slept[2]);
+    // the sleep timer runs off an RC oscillator; the real sleep differs
+    rs.bootWallUs += slept[0] + (uint64_t)(slept[1] * (1.0 + sc.sleepTimerPpm / 1e6));
+    RunnerState next = rs;
+    next.cycle++;
+    saveRunnerState(next);
+  }
+
+  printf("\n%u cycle(s), %.2f s awake in total, %zu bytes of RTC memory, "
+         "%llu heap allocation(s)\n",
+         cycles, totalAwakeUs / 1e6, sim::rtcMemorySize(),
+         (unsigned long long)totalAllocs);
+  if (checkAlloc && totalAllocs) {
+    fprintf(stderr, "FAIL: the wake cycle allocated on the heap\n");
+    return 1;
+  }
+  return 0;
+}
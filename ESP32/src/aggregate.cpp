@@ -0,0 +1,198 @@
+#include "aggregate.h"
+#include "aqi.h"
+#include "config.h"
+
+#define AGG_MAGIC 0x41474731 // "AGG1"
+#define AGG_FIELDS 3         // pm1, pm25, pm10
+#define AGG_HOURS 24
+
+// Upper bounds (µg/m³) of the p95 histogram buckets; the last bucket
+// takes everything above the last bound.
+static const uint16_t AGG_BOUNDS[] = {5,  10,  15,  20,  25,  35,  50, 75,
+                                      100, 150, 200, 300, 500, 1000};
+#define AGG_BUCKETS (sizeof(AGG_BOUNDS) / sizeof(AGG_BOUNDS[0]) + 1)
+
+static const char *const FIELD_NAMES[AGG_FIELDS] = {"pm1", "pm25", "pm10"};
+
+struct AggField {
+  uint32_t sum;
+  uint16_t min, max;
+  uint16_t hist[AGG_BUCKETS];
+};
+
+struct AggWindow {
+  uint32_t start; // unix time the window began, 0 if unused
+  uint16_t count;
+  AggField f[AGG_FIELDS];
+};
+
+// One clock hour of the rolling 24-hour mean
+struct HourSlot {
+  uint32_t hour; // unix time / 3600
+  uint16_t count;
+  uint32_t sum25, sum10;
+};
+
+struct Aggregates {
+  uint32_t magic;
+  AggWindow hour, day, prevDay;
+  HourSlot slots[AGG_HOURS];
+};
+
+static_assert(sizeof(Aggregates) <= 1024, "RTC slow memory is only 8 KB");
+
+static RTC_DATA_ATTR Aggregates agg;
+
+static void startWindow(AggWindow &w, uint32_t start) {
+  memset(&w, 0, sizeof(w));
+  w.start = start;
+  for (int i = 0; i < AGG_FIELDS; i++)
+    w.f[i].min = UINT16_MAX;
+}
+
+static void addToWindow(AggWindow &w, const uint16_t *v) {
+  w.count++;
+  for (int i = 0; i < AGG_FIELDS; i++) {
+    AggField &f = w.f[i];
+    f.sum += v[i];
+    f.min = min(f.min, v[i]);
+    f.max = max(f.max, v[i]);
+    size_t b = 0;
+    while (b < AGG_BUCKETS - 1 && v[i] > AGG_BOUNDS[b])
+      b++;
+    if (f.hist[b] < UINT16_MAX)
+      f.hist[b]++;
+  }
+}
+
+void aggregateAdd(const LogRecord &rec) {
+  if (agg.magic != AGG_MAGIC) {
+    memset(&agg, 0, sizeof(agg));
+    agg.magic = AGG_MAGIC;
+  }
+  if (rec.ts == 0 || rec.pm1 < 0 || rec.pm25 < 0 || rec.pm10 < 0)
+    return;
+
+  uint32_t hour = rec.ts / 3600;
+  // days start at local midnight
+  uint32_t day = (rec.ts + GMT_OFFSET_SEC) / 86400;
+  uint32_t dayStart = day * 86400 - GMT_OFFSET_SEC;
+
+  if (!agg.hour.start || agg.hour.start / 3600 != hour)
+    startWindow(agg.hour, hour * 3600);
+  if (!agg.day.start || agg.day.start != dayStart) {
+    // only the day right before today is worth keeping
+    if (agg.day.start + 86400 == dayStart)
+      agg.prevDay = agg.day;
+    else
+      agg.prevDay.start = 0;
+    startWindow(agg.day, dayStart);
+  }
+
+  uint16_t v[AGG_FIELDS] = {(uint16_t)rec.pm1, (uint16_t)rec.pm25,
+                            (uint16_t)rec.pm10};
+  addToWindow(agg.hour, v);
+  addToWindow(agg.day, v);
+
+  HourSlot &slot = agg.slots[hour % AGG_HOURS];
+  if (slot.hour != hour) {
+    memset(&slot, 0, sizeof(slot));
+    slot.hour = hour;
+  }
+  slot.count++;
+  slot.sum25 += v[1];
+  slot.sum10 += v[2];
+}
+
+// Interpolated within the histogram bucket that holds the 95th percentile,
+// then clamped to the observed range.
+static float approxP95(const AggField &f, uint16_t count) {
+  uint32_t rank = (count * 95 + 99) / 100; // ceil(0.95 n)
+  uint32_t below = 0;
+  for (size_t b = 0; b < AGG_BUCKETS; b++) {
+    if (below + f.hist[b] >= rank) {
+      float lo = b ? AGG_BOUNDS[b - 1] : 0;
+      float hi = b < AGG_BUCKETS - 1 ? AGG_BOUNDS[b] : f.max;
+      float p = lo + (hi - lo) * (rank - below) / f.hist[b];
+      return constrain(p, (float)f.min, (float)f.max);
+    }
+    below += f.hist[b];
+  }
+  return f.max;
+}
+
+// Mean PM2.5 and PM10 over the hourly slots of the last 24 hours
+static uint8_t rollingMeans(float &pm25, float &pm10) {
+  uint32_t newest = 0;
+  for (int i = 0; i < AGG_HOURS; i++)
+    newest = max(newest, agg.slots[i].hour);
+
+  uint8_t hours = 0;
+  float sum25 = 0, sum10 = 0;
+  for (int i = 0; i < AGG_HOURS; i++) {
+    const HourSlot &s = agg.slots[i];
+    if (!s.count || s.hour + AGG_HOURS <= newest)
+      continue;
+    // each hour weighs the same, however many readings it had
+    sum25 += (float)s.sum25 / s.count;
+    sum10 += (float)s.sum10 / s.count;
+    hours++;
+  }
+  pm25 = hours ? sum25 / hours : NAN;
+  pm10 = hours ? sum10 / hours : NAN;
+  return hours;
+}
+
+static int formatWindow(char *buf, size_t size, const char *key,
+                        const AggWindow &w) {
+  if (!w.start || !w.count)
+    return 0;
+  int len = snprintf(buf, size, ",\"%s\":{\"t\":%u,\"n\":%u", key,
+                     (unsigned)w.start, w.count);
+  for (int i = 0; i < AGG_FIELDS && len < (int)size; i++) {
+    const AggField &f = w.f[i];
+    len += snprintf(buf + len, size - len, ",\"%s\":[%.1f,%u,%u,%.1f]",
+                    FIELD_NAMES[i], (float)f.sum / w.count, f.min, f.max,
+                    approxP95(f, w.count));
+  }
+  if (len < (int)size)
+    len += snprintf(buf + len, size - len, "}");
+  return len;
+}
+
+int formatAggregates(char *buf, size_t size) {
+  if (agg.magic != AGG_MAGIC || !agg.hour.start)
+    return 0;
+
+  float pm25, pm10;
+  uint8_t hours = rollingMeans(pm25, pm10);
+  // {"aqi":{...},"h":{...},"d":{...},"pd":{...}}; each window is
+  // {"t":start,"n":count,"pm1":[mean,min,max,p95],"pm25":[...],"pm10":[...]}
+  int len = snprintf(buf, size,
+                     "{\"aqi\":{\"hours\":%u,\"pm25\":%.1f,\"pm10\":%.1f,"
+                     "\"us\":%d,\"np\":%d}",
+                     hours, pm25, pm10, aqiUs(pm25, pm10),
+                     aqiNepal(pm25, pm10));
+  if (len < (int)size)
+    len += formatWindow(buf + len, size - len, "h", agg.hour);
+  if (len < (int)size)
+    len += formatWindow(buf + len, size - len, "d", agg.day);
+  if (len < (int)size)
+    len += formatWindow(buf + len, size - len, "pd", agg.prevDay);
+  if (len < (int)size)
+    len += snprintf(buf + len, size - len, "}");
+  return len;
+}
+
+void printAggregates() {
+  if (agg.magic != AGG_MAGIC || !agg.day.count)
+    return;
+  float pm25, pm10;
+  uint8_t hours = rollingMeans(pm25, pm10);
+  const AggField &d = agg.day.f[1];
+  Serial.printf("🌫️ PM2.5 today: mean %.1f, max %u, p95 %.1f (%u readings)\n",
+                (float)d.sum / agg.day.count, d.max,
+                approxP95(d, agg.day.count), agg.day.count);
+  Serial.printf("🌫️ AQI over %u h: US %d, Nepal %d\n", hours,
+                aqiUs(pm25, pm10), aqiNepal(pm25, pm10));
+}
@@ -0,0 +1,155 @@
+#include "archive.h"
+
+// Writes the low `bits` bits of value, MSB first. Returns false without
+// writing anything once the payload is full.
+static bool putBits(ArchiveEncoder &enc, uint32_t value, uint8_t bits) {
+  if (enc.bitPos + bits > ARCHIVE_PAYLOAD_SIZE * 8)
+    return false;
+  uint8_t *payload = enc.block + sizeof(ArchiveBlockHeader);
+  while (bits--) {
+    size_t byte = enc.bitPos >> 3;
+    uint8_t mask = 0x80 >> (enc.bitPos & 7);
+    if ((value >> bits) & 1)
+      payload[byte] |= mask;
+    else
+      payload[byte] &= ~mask;
+    enc.bitPos++;
+  }
+  return true;
+}
+
+static bool putTimestamp(ArchiveEncoder &enc, uint32_t ts) {
+  ArchiveState &s = enc.state;
+  int64_t interval = (int64_t)ts - s.ts;
+  int64_t dod = interval - s.interval;
+  s.ts = ts;
+  s.interval = interval;
+
+  if (dod == 0)
+    return putBits(enc, 0, 1);
+  if (dod >= -64 && dod < 64)
+    return putBits(enc, 0b10, 2) && putBits(enc, dod & 0x7F, 7);
+  if (dod >= -256 && dod < 256)
+    return putBits(enc, 0b110, 3) && putBits(enc, dod & 0x1FF, 9);
+  if (dod >= -2048 && dod < 2048)
+    return putBits(enc, 0b1110, 4) && putBits(enc, dod & 0xFFF, 12);
+  return putBits(enc, 0b1111, 4) && putBits(enc, ts, 32);
+}
+
+static bool putFloat(ArchiveEncoder &enc, ArchiveFloat &prev, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t x = bits ^ prev.bits;
+  prev.bits = bits;
+  if (x == 0)
+    return putBits(enc, 0, 1);
+
+  uint8_t leading = __builtin_clz(x);
+  uint8_t trailing = __builtin_ctz(x);
+  if (prev.leading + prev.trailing > 0 && leading >= prev.leading &&
+      trailing >= prev.trailing) {
+    uint8_t len = 32 - prev.leading - prev.trailing;
+    return putBits(enc, 0b10, 2) && putBits(enc, x >> prev.trailing, len);
+  }
+
+  uint8_t len = 32 - leading - trailing;
+  prev.leading = leading;
+  prev.trailing = trailing;
+  return putBits(enc, 0b11, 2) && putBits(enc, leading, 5) &&
+         putBits(enc, len - 1, 5) && putBits(enc, x >> trailing, len);
+}
+
+static bool putDelta(ArchiveEncoder &enc, int16_t &prev, int16_t value) {
+  int32_t delta = (int32_t)value - prev;
+  uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+  prev = value;
+  do {
+    uint32_t group = zigzag & 0x7;
+    zigzag >>= 3;
+    if (!putBits(enc, (zigzag ? 0x8 : 0) | group, 4))
+      return false;
+  } while (zigzag);
+  return true;
+}
+
+static void widen(int16_t &lo, int16_t &hi, float value, float scale) {
+  float x = value * scale;
+  if (isnan(x) || x < INT16_MIN || x > INT16_MAX)
+    return;
+  int16_t v = (int16_t)lroundf(x);
+  lo = min(lo, v);
+  hi = max(hi, v);
+}
+
+void archiveBegin(ArchiveEncoder &enc) {
+  memset(&enc, 0, sizeof(enc));
+  enc.stats.tempMin = enc.stats.humMin = enc.stats.pm25Min = INT16_MAX;
+  enc.stats.tempMax = enc.stats.humMax = enc.stats.pm25Max = INT16_MIN;
+}
+
+bool archiveAdd(ArchiveEncoder &enc, const LogRecord &rec) {
+  size_t bitPos = enc.bitPos;
+  ArchiveState state = enc.state;
+
+  ArchiveState &s = enc.state;
+  bool ok = putTimestamp(enc, rec.ts) && putFloat(enc, s.temp, rec.temp) &&
+            putFloat(enc, s.hum, rec.hum) && putFloat(enc, s.vin, rec.vin) &&
+            putFloat(enc, s.battery, rec.battery) &&
+            putDelta(enc, s.pm1, rec.pm1) && putDelta(enc, s.pm25, rec.pm25) &&
+            putDelta(enc, s.pm10, rec.pm10);
+  if (ok && rec.status == s.status) {
+    ok = putBits(enc, 0, 1);
+  } else if (ok) {
+    ok = putBits(enc, 1, 1) && putBits(enc, rec.status, 16);
+    s.status = rec.status;
+  }
+  if (!ok) {
+    // Bits past the old position are ignored; putBits overwrites them
+    enc.bitPos = bitPos;
+    enc.state = state;
+    return false;
+  }
+
+  ArchiveStats &st = enc.stats;
+  st.count++;
+  if (rec.ts) {
+    uint32_t ts = rec.ts;
+    st.tsMin = st.tsMin ? min(st.tsMin, ts) : ts;
+    st.tsMax = max(st.tsMax, ts);
+  }
+  widen(st.tempMin, st.tempMax, rec.temp, 100);
+  widen(st.humMin, st.humMax, rec.hum, 100);
+  int16_t pm25 = rec.pm25;
+  if (pm25 >= 0) {
+    st.pm25Min = min(st.pm25Min, pm25);
+    st.pm25Max = max(st.pm25Max, pm25);
+  }
+  return true;
+}
+
+void archiveFinish(ArchiveEncoder &enc) {
+  uint8_t *payload = enc.block + sizeof(ArchiveBlockHeader);
+  // clear whatever a rejected record left behind the last one
+  size_t used = (enc.bitPos + 7) / 8;
+  if (enc.bitPos & 7)
+    payload[used - 1] &= 0xFF << (8 - (enc.bitPos & 7));
+  memset(payload + used, 0, ARCHIVE_PAYLOAD_SIZE - used);
+
+  const ArchiveStats &st = enc.stats;
+  ArchiveBlockHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, ARCHIVE_MAGIC, sizeof(hdr.magic));
+  hdr.version = ARCHIVE_VERSION;
+  hdr.count = st.count;
+  hdr.tsMin = st.tsMin;
+  hdr.tsMax = st.tsMax;
+  hdr.tempMin = st.tempMin;
+  hdr.tempMax = st.tempMax;
+  hdr.humMin = st.humMin;
+  hdr.humMax = st.humMax;
+  hdr.pm25Min = st.pm25Min;
+  hdr.pm25Max = st.pm25Max;
+  hdr.payloadCrc = crc16(payload, ARCHIVE_PAYLOAD_SIZE);
+  hdr.crc = crc16((const uint8_t *)&hdr, sizeof(hdr) - sizeof(hdr.crc));
+  memcpy(enc.block, &hdr, sizeof(hdr));
+}
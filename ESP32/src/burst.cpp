@@ -0,0 +1,126 @@
+#include "burst.h"
+#include "config.h"
+#include "globals.h"
+#include "record.h"
+#include "rtc.h"
+#include "sensors.h"
+#include "storage.h"
+
+const uint16_t BURST_CAPACITY = BURST_MAX_MS / BURST_PERIOD_MS;
+
+// Plain RAM: the samples are written to SD before this wake ends
+static LogRecord burstSamples[BURST_CAPACITY];
+static uint16_t burstSampleCount = 0;
+
+// Sampling time used per local day, kept across deep sleep
+struct BurstBudget {
+  uint32_t day; // local days since 1970
+  uint32_t usedS;
+};
+
+static RTC_DATA_ATTR BurstBudget burstBudget = {0, 0};
+
+static uint32_t localDay() { return rtcLocalSeconds() / 86400; }
+
+static uint32_t budgetLeftS() {
+  uint32_t day = localDay();
+  if (day != burstBudget.day) {
+    burstBudget.day = day;
+    burstBudget.usedS = 0;
+  }
+  return burstBudget.usedS < BURST_DAILY_MAX_S
+             ? BURST_DAILY_MAX_S - burstBudget.usedS
+             : 0;
+}
+
+bool burstShouldStart(int pm25, float vin, float battery, bool sdOk) {
+  if (pm25 < BURST_ENTER_PM25)
+    return false;
+  if (!sdOk) {
+    Serial.println(F("⚠️ Burst skipped: no SD card to hold the samples"));
+    return false;
+  }
+  bool onBattery = vin < SCHEDULE_ON_BATTERY_VIN && battery > 1.0f;
+  if (onBattery && battery < BURST_MIN_BATTERY_V) {
+    Serial.printf("⚠️ Burst skipped: on battery at %.2f V\n", battery);
+    return false;
+  }
+  if (budgetLeftS() < BURST_PERIOD_MS / 1000) {
+    Serial.println(F("⚠️ Burst skipped: today's burst time is used up"));
+    return false;
+  }
+  return true;
+}
+
+void runBurst(float vin, float battery) {
+  uint32_t start = millis();
+  uint32_t limit = min(BURST_MAX_MS, budgetLeftS() * 1000);
+  uint8_t below = 0;
+  int peak = 0;
+  const char *why = "window limit";
+  burstSampleCount = 0;
+  Serial.printf("💨 Burst: sampling every %u s for up to %u s\n",
+                (unsigned)(BURST_PERIOD_MS / 1000), (unsigned)(limit / 1000));
+
+  while (burstSampleCount < BURST_CAPACITY && millis() - start < limit) {
+    // average the active-mode frames that arrive during one period
+    uint32_t periodEnd = start + (burstSampleCount + 1) * BURST_PERIOD_MS;
+    uint32_t sum[3] = {0, 0, 0};
+    uint16_t frames = 0;
+    uint16_t pm[3];
+    while (readPMSFrame(pm, periodEnd)) {
+      for (int ch = 0; ch < 3; ch++)
+        sum[ch] += pm[ch];
+      frames++;
+    }
+    if (!frames) {
+      setStatus(STATUS_PMS, false);
+      why = "PMS7003 stopped streaming";
+      break;
+    }
+
+    int pm25 = (sum[1] + frames / 2) / frames;
+    LogRecord &rec = burstSamples[burstSampleCount++];
+    beginRecord(rec);
+    if (statusOk(STATUS_AHT)) {
+      sensors_event_t h, t;
+      aht.getEvent(&h, &t);
+      rec.temp = t.temperature;
+      rec.hum = h.relative_humidity;
+    }
+    rec.pm1 = (sum[0] + frames / 2) / frames;
+    rec.pm25 = pm25;
+    rec.pm10 = (sum[2] + frames / 2) / frames;
+    rec.vin = vin;
+    rec.battery = battery;
+    finishRecord(rec, rtcUnixTime(), STATUS_BURST);
+    peak = max(peak, pm25);
+
+    below = pm25 < BURST_EXIT_PM25 ? below + 1 : 0;
+    if (below >= BURST_EXIT_SAMPLES) {
+      why = "PM2.5 back down";
+      break;
+    }
+  }
+
+  uint32_t elapsedS = (millis() - start + 999) / 1000;
+  budgetLeftS(); // rolls the day over if midnight passed
+  burstBudget.usedS += elapsedS;
+  Serial.printf("💨 Burst: %u samples over %u s, peak PM2.5 %d, ended by %s "
+                "(%u s left today)\n",
+                burstSampleCount, (unsigned)elapsedS, peak, why,
+                (unsigned)budgetLeftS());
+}
+
+uint16_t burstCount() { return burstSampleCount; }
+
+bool flushBurst(const char *logFile) {
+  if (!burstSampleCount)
+    return true;
+  if (!appendRecords(logFile, burstSamples, burstSampleCount) || !flushLog())
+    return false;
+  Serial.printf("✔ %u burst sample(s) appended to %s\n", burstSampleCount,
+                logFile);
+  burstSampleCount = 0;
+  return true;
+}
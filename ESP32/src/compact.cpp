@@ -0,0 +1,62 @@
+#include "compact.h"
+
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_ARRAY 4
+#define CBOR_NULL 0xF6
+
+size_t cborHead(uint8_t major, uint64_t value, uint8_t *out) {
+  major <<= 5;
+  if (value < 24) {
+    out[0] = major | value;
+    return 1;
+  }
+  size_t n = value <= 0xFF ? 1 : value <= 0xFFFF ? 2 : value <= 0xFFFFFFFF ? 4 : 8;
+  out[0] = major | (n == 1 ? 24 : n == 2 ? 25 : n == 4 ? 26 : 27);
+  for (size_t i = 0; i < n; i++)
+    out[n - i] = value >> (8 * i); // big-endian
+  return n + 1;
+}
+
+size_t cborInt(int64_t value, uint8_t *out) {
+  return value >= 0 ? cborHead(CBOR_UINT, value, out)
+                    : cborHead(CBOR_NEGINT, -1 - value, out);
+}
+
+void compactReset(CompactState &state) {
+  memset(&state, 0, sizeof(state));
+}
+
+size_t compactEncodeRecord(const LogRecord &rec, CompactState &state, uint8_t *out) {
+  // NaN (or a value too wild to scale) is sent as null
+  const int64_t MISSING = INT64_MIN;
+  auto scaled = [&](float v, float scale) {
+    float x = v * scale;
+    return isnan(x) || fabsf(x) > 2e9f ? MISSING : (int64_t)lroundf(x);
+  };
+  int64_t v[COMPACT_FIELDS] = {
+      rec.ts,
+      scaled(rec.temp, 100),
+      scaled(rec.hum, 100),
+      rec.pm1,
+      rec.pm25,
+      rec.pm10,
+      scaled(rec.battery, 1000),
+      scaled(rec.vin, 1000),
+  };
+
+  size_t len = cborHead(CBOR_ARRAY, COMPACT_FIELDS + 2, out);
+  for (int i = 0; i < COMPACT_FIELDS; i++) {
+    if (v[i] == MISSING) {
+      out[len++] = CBOR_NULL;
+      continue;
+    }
+    len += cborInt(v[i] - state.prev[i], out + len);
+    state.prev[i] = v[i];
+  }
+  len += cborHead(CBOR_UINT, rec.status, out + len);
+  // wraps with the counter, so a steady stream stays at 1
+  len += cborInt((int16_t)(rec.seq - state.prevSeq), out + len);
+  state.prevSeq = rec.seq;
+  return len;
+}
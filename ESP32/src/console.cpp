@@ -0,0 +1,138 @@
+#include "console.h"
+#include "config.h"
+#include "export.h"
+#include "rtc.h"
+#include "voltage.h"
+#include <RTClib.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t CONSOLE_LINE_MAX = 48;
+
+static void printHelp() {
+  Serial.println(F("Commands:"));
+  Serial.println(F("  cal vin <V>   calibrate Vin against a known voltage"));
+  Serial.println(F("  cal bat <V>   calibrate battery against a known voltage"));
+  Serial.println(F("  cal show      show gains and readings"));
+  Serial.println(F("  cal reset     clear the calibration"));
+  Serial.println(F("  export <from> [<to>]"));
+  Serial.println(F("                stream a date range (YYYY-MM[-DD]) at"));
+  Serial.println(F("                high baud, for tools/export.py"));
+}
+
+static void runCalibration(char *args) {
+  char *what = strtok(args, " \t");
+  char *value = strtok(nullptr, " \t");
+
+  if (what && strcmp(what, "show") == 0) {
+    float vin, battery;
+    readVoltages(vin, battery);
+    Serial.printf("Vin     %.3f V (gain %.4f)\n", vin,
+                  getVoltageGain(VOLT_VIN));
+    Serial.printf("Battery %.3f V (gain %.4f)\n", battery,
+                  getVoltageGain(VOLT_BATTERY));
+    return;
+  }
+  if (what && strcmp(what, "reset") == 0) {
+    resetVoltageCalibration();
+    return;
+  }
+
+  VoltageChannel ch;
+  if (what && strcmp(what, "vin") == 0) {
+    ch = VOLT_VIN;
+  } else if (what && strcmp(what, "bat") == 0) {
+    ch = VOLT_BATTERY;
+  } else {
+    Serial.println(F("❌ usage: cal vin|bat <volts>, cal show, cal reset"));
+    return;
+  }
+
+  char *end = nullptr;
+  float volts = value ? strtof(value, &end) : NAN;
+  if (!value || end == value || !(volts > 0)) {
+    Serial.println(F("❌ cal needs the applied voltage, e.g. cal bat 4.10"));
+    return;
+  }
+  calibrateVoltage(ch, volts);
+}
+
+// YYYY-MM-DD or YYYY-MM in local time, as the unix time of its first
+// second; *end gets the first second after the day or month
+static bool parseDate(const char *text, uint32_t &start, uint32_t &end) {
+  int year, month, day = 0;
+  char extra;
+  int n = text ? sscanf(text, "%d-%d-%d%c", &year, &month, &day, &extra) : 0;
+  if ((n != 2 && n != 3) || year < 2000 || year > 2099 || month < 1 ||
+      month > 12 || (n == 3 && (day < 1 || day > 31)))
+    return false;
+  const uint32_t offset = GMT_OFFSET_SEC + DAYLIGHT_OFFSET_SEC;
+  DateTime first(year, month, n == 3 ? day : 1);
+  start = first.unixtime() - offset;
+  if (n == 3)
+    end = start + 86400;
+  else
+    end = DateTime(month == 12 ? year + 1 : year, month % 12 + 1, 1)
+              .unixtime() - offset;
+  return true;
+}
+
+static void runExport(char *args) {
+  char *fromText = strtok(args, " \t");
+  char *toText = strtok(nullptr, " \t");
+  uint32_t from, to, unused;
+  if (!parseDate(fromText, from, unused) ||
+      (toText && !parseDate(toText, unused, to))) {
+    Serial.println(F("❌ usage: export <from> [<to>], dates YYYY-MM[-DD]"));
+    return;
+  }
+  if (toText)
+    to--; // the whole of the last day or month
+  else if (!(to = rtcUnixTime()))
+    to = from + 366UL * 86400; // no clock: a year from the start
+  if (to < from) {
+    Serial.println(F("❌ export range ends before it starts"));
+    return;
+  }
+  exportRange(MASTER_LOG_FILE, ARCHIVE_DIR, from, to);
+}
+
+static void runCommand(char *line) {
+  while (*line == ' ' || *line == '\t')
+    line++;
+  if (*line == '\0')
+    return;
+
+  Serial.printf("> %s\n", line);
+  if (strncmp(line, "cal", 3) == 0 && (line[3] == ' ' || line[3] == '\0'))
+    runCalibration(line + 3);
+  else if (strncmp(line, "export", 6) == 0 &&
+           (line[6] == ' ' || line[6] == '\0'))
+    runExport(line + 6);
+  else if (strcmp(line, "help") == 0)
+    printHelp();
+  else
+    Serial.println(F("❌ unknown command, try help"));
+}
+
+void pollConsole(uint32_t windowMs) {
+  char line[CONSOLE_LINE_MAX];
+  size_t len = 0;
+  uint32_t deadline = millis() + windowMs;
+
+  while ((int32_t)(deadline - millis()) > 0) {
+    if (!Serial.available()) {
+      delay(10);
+      continue;
+    }
+    char c = Serial.read();
+    if (c == '\r' || c == '\n') {
+      line[len] = '\0';
+      runCommand(line);
+      len = 0;
+      deadline = millis() + windowMs;
+    } else if (len < CONSOLE_LINE_MAX - 1) {
+      line[len++] = c;
+    }
+  }
+}
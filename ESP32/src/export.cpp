@@ -0,0 +1,176 @@
+#include "export.h"
+#include "archive.h"
+#include "config.h"
+#include "globals.h"
+#include "record.h"
+#include "storage.h"
+#include <SD.h>
+
+// One frame at a time: type and length, payload read straight from the
+// card behind them, CRC after, so the CRC covers one contiguous buffer
+static const size_t FRAME_HEAD = 3;
+static uint8_t frame[FRAME_HEAD + EXPORT_CHUNK_BYTES + 2];
+static const uint32_t BLOCKS_PER_FRAME = EXPORT_CHUNK_BYTES / ARCHIVE_BLOCK_SIZE;
+static const uint32_t RECORDS_PER_FRAME = EXPORT_CHUNK_BYTES / LOG_RECORD_SIZE;
+static const uint32_t INDEX_WINDOW = 64; // index entries read at once
+
+static void sendFrame(char type, size_t len) {
+  frame[0] = type;
+  frame[1] = len & 0xFF;
+  frame[2] = len >> 8;
+  uint16_t crc = crc16(frame, FRAME_HEAD + len);
+  frame[FRAME_HEAD + len] = crc & 0xFF;
+  frame[FRAME_HEAD + len + 1] = crc >> 8;
+  Serial.write(frame, FRAME_HEAD + len + 2);
+}
+
+// Reads `count` consecutive blocks from the partition into one 'A' frame
+static bool sendBlocks(File &bin, uint32_t first, uint32_t count) {
+  size_t len = count * ARCHIVE_BLOCK_SIZE;
+  if (!bin.seek(first * ARCHIVE_BLOCK_SIZE) ||
+      bin.read(frame + FRAME_HEAD, len) != len)
+    return false;
+  sendFrame('A', len);
+  return true;
+}
+
+// Window of the open partition's index, read INDEX_WINDOW entries at once
+static ArchiveIndexEntry indexWindow[INDEX_WINDOW];
+static uint32_t windowStart, windowLen;
+
+// Time range of a block: from the month's index, or from the block header
+// itself where the index is short (its write did not make it)
+static bool blockRange(File &bin, File &idx, uint32_t entries, uint32_t block,
+                       ArchiveIndexEntry &out) {
+  if (block >= entries) {
+    ArchiveBlockHeader hdr;
+    if (!bin.seek(block * ARCHIVE_BLOCK_SIZE) ||
+        bin.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr))
+      return false;
+    out.tsMin = hdr.tsMin;
+    out.tsMax = hdr.tsMax;
+    return true;
+  }
+  if (block < windowStart || block >= windowStart + windowLen) {
+    windowStart = block;
+    windowLen = min(INDEX_WINDOW, entries - block);
+    size_t bytes = windowLen * sizeof(ArchiveIndexEntry);
+    if (!idx.seek(block * sizeof(ArchiveIndexEntry)) ||
+        idx.read((uint8_t *)indexWindow, bytes) != bytes) {
+      windowLen = 0;
+      return false;
+    }
+  }
+  out = indexWindow[block - windowStart];
+  return true;
+}
+
+static uint32_t exportPartition(const char *archiveDir, uint32_t month,
+                                uint32_t from, uint32_t to) {
+  char path[32];
+  archivePartitionPath(path, sizeof(path), archiveDir, month, "bin");
+  File bin = SD.open(path, FILE_READ);
+  if (!bin)
+    return 0;
+  archivePartitionPath(path, sizeof(path), archiveDir, month, "idx");
+  File idx = SD.open(path, FILE_READ);
+
+  uint32_t entries = idx ? idx.size() / sizeof(ArchiveIndexEntry) : 0;
+  windowLen = 0;
+
+  uint32_t blocks = bin.size() / ARCHIVE_BLOCK_SIZE;
+  uint32_t runStart = 0, runLen = 0, sent = 0;
+  for (uint32_t b = 0; b <= blocks; b++) {
+    ArchiveIndexEntry entry;
+    // Blocks without a clock reading are left out of a ranged export
+    bool hit = b < blocks && blockRange(bin, idx, entries, b, entry) &&
+               entry.tsMax && entry.tsMax >= from && entry.tsMin <= to;
+    if (hit && runLen && runStart + runLen == b && runLen < BLOCKS_PER_FRAME) {
+      runLen++;
+      continue;
+    }
+    if (runLen && sendBlocks(bin, runStart, runLen))
+      sent += runLen;
+    runLen = 0;
+    if (hit) {
+      runStart = b;
+      runLen = 1;
+    }
+  }
+
+  if (idx)
+    idx.close();
+  bin.close();
+  return sent;
+}
+
+// The log's header, then its records from the archive cursor on, as stored
+static uint32_t exportLogTail(const char *logFile) {
+  File log = SD.open(logFile, FILE_READ);
+  if (!log)
+    return 0;
+  LogHeader hdr;
+  if (log.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+      !logHeaderValid(hdr)) {
+    log.close();
+    return 0;
+  }
+  memcpy(frame + FRAME_HEAD, &hdr, sizeof(hdr));
+  sendFrame('H', sizeof(hdr));
+
+  uint32_t total = logRecordCount(log);
+  uint32_t next = archiveCursor(hdr);
+  if (next > total)
+    next = 0;
+  uint32_t sent = 0;
+  while (next < total) {
+    uint32_t n = min(RECORDS_PER_FRAME, total - next);
+    size_t len = n * LOG_RECORD_SIZE;
+    if (!log.seek(LOG_HEADER_SIZE + next * LOG_RECORD_SIZE) ||
+        log.read(frame + FRAME_HEAD, len) != len)
+      break;
+    sendFrame('L', len);
+    next += n;
+    sent += n;
+  }
+  log.close();
+  return sent;
+}
+
+bool exportRange(const char *logFile, const char *archiveDir, uint32_t from,
+                 uint32_t to) {
+  initSD();
+  if (!statusOk(STATUS_SD)) {
+    Serial.println(F("❌ export needs the SD card"));
+    return false;
+  }
+  closeLog(); // the tail is read through its own handle
+
+  Serial.printf("📤 Export %u..%u at %u baud\n", (unsigned)from,
+                (unsigned)to, (unsigned)EXPORT_BAUD);
+  Serial.flush();
+  Serial.begin(EXPORT_BAUD);
+  delay(EXPORT_SWITCH_MS);
+
+  uint32_t start = millis();
+  Serial.write((const uint8_t *)EXPORT_MAGIC, 4);
+  Serial.write((uint8_t)EXPORT_VERSION);
+
+  uint32_t blocks = 0;
+  uint32_t last = archiveMonth(to);
+  for (uint32_t month = archiveMonth(from); month && month <= last; month++)
+    blocks += exportPartition(archiveDir, month, from, to);
+  uint32_t records = exportLogTail(logFile);
+
+  uint32_t ms = millis() - start;
+  uint32_t end[3] = {blocks, records, ms};
+  memcpy(frame + FRAME_HEAD, end, sizeof(end));
+  sendFrame('E', sizeof(end));
+
+  Serial.flush();
+  delay(EXPORT_SWITCH_MS);
+  Serial.begin(CONSOLE_BAUD);
+  Serial.printf("📤 Exported %u archive block(s) and %u log record(s) in %u ms\n",
+                (unsigned)blocks, (unsigned)records, (unsigned)ms);
+  return true;
+}
@@ -1,149 +1,254 @@
 #include "esp_sleep.h"
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
 #include <SD.h>
 #include <SPI.h>
 #include <Wire.h>
 
 // Custom Modules
+#include "aggregate.h"
+#include "burst.h"
 #include "config.h"
+#include "console.h"
 #include "globals.h"
 #include "network.h"
+#include "profiler.h"
 #include "rtc.h"
+#include "rtcbuffer.h"
+#include "scheduler.h"
+#include "sensor_registry.h"
 #include "sensors.h"
 #include "storage.h"
+#include "uplink.h"
+#include "uploader.h"
+#include "voltage.h"
 
 
 uint64_t startTime = 0;
 
+// Every sensor this build reads, in reading order. A new sensor is a
+// driver struct added here (see sensor_registry.h).
+typedef SensorRegistry<Aht20Sensor, Pms7003Sensor, SupplySensor> Sensors;
+
+static bool ntpSkipped = false; // the RTC drift model made NTP unnecessary
+
 void printStatus() {
   Serial.println("\n===== DEVICE STATUS =====");
-  Serial.printf("AHT20        : %s\n", statusAHT ? "OK" : "FAILED");
-  Serial.printf("RTC          : %s\n", statusRTC ? "OK" : "FAILED");
-  Serial.printf("PMS7003      : %s\n", statusPMS ? "OK" : "FAILED");
-  Serial.printf("WiFi         : %s\n", statusWiFi ? "OK" : "FAILED");
-  Serial.printf("NTP          : %s\n", statusNTP ? "OK" : "FAILED");
-  Serial.printf("ThingSpeak   : %s\n", statusThingSpeak ? "OK" : "FAILED");
-  Serial.printf("Render       : %s\n", statusRender ? "OK" : "FAILED");
-  Serial.printf("SD Card      : %s\n", statusSD ? "OK" : "FAILED");
+  Serial.printf("AHT20        : %s\n", statusOk(STATUS_AHT) ? "OK" : "FAILED");
+  Serial.printf("RTC          : %s\n", statusOk(STATUS_RTC) ? "OK" : "FAILED");
+  Serial.printf("PMS7003      : %s\n", statusOk(STATUS_PMS) ? "OK" : "FAILED");
+  Serial.printf("WiFi         : %s (%u ms%s)\n", statusOk(STATUS_WIFI) ? "OK" : "FAILED",
+                (unsigned)getWiFiStats().connectMs,
+                getWiFiStats().fastPath ? ", fast" : "");
+  Serial.printf("NTP          : %s\n", ntpSkipped          ? "NOT NEEDED"
+                                       : statusOk(STATUS_NTP) ? "OK"
+                                                              : "FAILED");
+  Serial.printf("ThingSpeak   : %s\n", statusOk(STATUS_THINGSPEAK) ? "OK" : "FAILED");
+  Serial.printf("Render       : %s\n", statusOk(STATUS_RENDER) ? "OK" : "FAILED");
+  Serial.printf("SD Card      : %s\n", statusOk(STATUS_SD) ? "OK" : "FAILED");
   Serial.println("=========================\n");
 }
 
+// ----- CONCURRENT NETWORK PHASE -----
+// WiFi, NTP and the replay of earlier wakes' readings run in their own task
+// on core 0 (next to the WiFi stack) while setup() warms up the PMS7003 and
+// samples the ADC on core 1. NET_DONE_BIT tells setup() the phase is over.
+#define NET_DONE_BIT BIT0
+
+static EventGroupHandle_t cycleEvents = nullptr;
+// Static so the wake never touches the heap for them
+static StaticEventGroup_t cycleEventsBuffer;
+static StaticTask_t networkTaskTcb;
+static StackType_t networkTaskStack[NETWORK_TASK_STACK];
+static struct tm ntpTime;
+static bool ntpOk = false;
+
+static void networkPhase() {
+  // --- WiFi ---
+  profileBegin(PHASE_WIFI);
+  connectWiFi();
+  profileEnd(PHASE_WIFI);
+  if (!statusOk(STATUS_WIFI))
+    return;
+
+  // --- Refresh time from NTP, unless the RTC drift model vouches for it ---
+  profileBegin(PHASE_NTP);
+  ntpSkipped = !ntpSyncDue();
+  if (!ntpSkipped)
+    ntpOk = syncTimeAndRTC(ntpTime);
+  profileEnd(PHASE_NTP);
+
+  // --- Replay readings queued by earlier wakes ---
+  profileBegin(PHASE_SD);
+  initSD();
+  bool flushed = statusOk(STATUS_SD) && flushRtcBuffer(MASTER_LOG_FILE);
+  profileEnd(PHASE_SD);
+  if (flushed) {
+    // No meta yet: core 1 is still warming up the PMS, and the post-reading
+    // dispatch sends the meta for this whole wake.
+    profileBegin(PHASE_BACKLOG);
+    dispatchUploads(MASTER_LOG_FILE, false);
+    profileEnd(PHASE_BACKLOG);
+  }
+}
+
+static void networkTask(void *) {
+  networkPhase();
+  xEventGroupSetBits(cycleEvents, NET_DONE_BIT);
+  vTaskDelete(nullptr);
+}
+
 void setup() {
   startTime = millis();
 
-  Serial.begin(9600);
-  delay(1000);
+  Serial.begin(CONSOLE_BAUD);
   Serial.println(F("Sensors ON"));
 
-  // ----- VOLTAGE ADC SETUP -----
-  analogReadResolution(12);
-  analogSetPinAttenuation(ADC_PIN1, ADC_11db);
-  analogSetPinAttenuation(ADC_PIN2, ADC_11db);
-
-  // Initialize AHT20 and PM7003 sensor
-  initSensors();
-
-  // --- RTC ---
+  // ----- SENSOR SETUP (I2C, PMS UART, voltage ADC, RTC) -----
+  profileBegin(PHASE_SENSOR_INIT);
+  Sensors::begin();
   initRTC();
+  profileEnd(PHASE_SENSOR_INIT);
 
-  // --- WiFi ---
-  connectWiFi();
+  // Replaces the old settle delay: a second to type a console command.
+  // After the RTC, so "export" knows the time zone and today's date.
+  pollConsole(CONSOLE_WINDOW_MS);
 
-  // --- Get time ---
+  // --- Get time (RTC until NTP is reachable) ---
   struct tm timeinfo;
-  bool ntp_ok = false;
-  ntp_ok = syncTimeAndRTC(timeinfo);
-
-  if (ntp_ok == false) {
-    getRTCTime(timeinfo);
-    statusNTP = false;
+  getRTCTime(timeinfo);
+  // Set again if NTP syncs this wake; an RTC the drift model vouches for
+  // is as good, so skipped syncs and offline wakes are not reported as
+  // clock faults
+  setStatus(STATUS_NTP, rtcTimeTrusted());
+
+  // --- Store-and-forward: decide early whether the radio is needed ---
+  // The SD card is not touched yet, so its health and queue length are the
+  // ones remembered from the last wake that used it.
+  initRtcBuffer();
+  setStatus(STATUS_SD, rtcBufferSdHealthy());
+  uint32_t pending = rtcBufferSdPending() + rtcBufferCount() + 1;
+  UplinkReason uplink = uplinkDueBeforeReading(pending, statusOk(STATUS_SD));
+
+  cycleEvents = xEventGroupCreateStatic(&cycleEventsBuffer);
+  if (uplink != UPLINK_NONE) {
+    Serial.printf("📡 Uplink: %s, starting network alongside sensors\n",
+                  uplinkReasonName(uplink));
+    xTaskCreateStaticPinnedToCore(networkTask, "network", NETWORK_TASK_STACK,
+                                  nullptr, 1, networkTaskStack,
+                                  &networkTaskTcb, 0);
   }
 
-  // --- Read Sensor Data (AHT & PMS) ---
-  float temperature = NAN, humidity = NAN;
-  int pm1_0 = -1, pm2_5 = -1, pm10 = -1;
-  bool pmReadSuccess = false;
-
-  temperature = readTemperature(humidity);
-  pmReadSuccess = readPMData(pm1_0, pm2_5, pm10);
-
-  if (isnan(temperature) || isnan(humidity)) {
-    Serial.println(F("❌ Invalid AHT data"));
-    statusAHT = false;
-  }
-  if (!pmReadSuccess) {
-    Serial.println(F("❌ PM read failed in loop"));
-    statusPMS = false;
+  // --- Read every sensor into this wake's record ---
+  LogRecord record;
+  beginRecord(record);
+  Sensors::read(record);
+
+  // --- Pollution event: keep the PMS running and sample densely ---
+  if (statusOk(STATUS_PMS) &&
+      burstShouldStart(record.pm25, record.vin, record.battery,
+                       statusOk(STATUS_SD))) {
+    profileBegin(PHASE_BURST);
+    runBurst(record.vin, record.battery);
+    profileEnd(PHASE_BURST);
   }
 
-  // --- Read Voltage Data ---
-  float voltage1 = readVoltage(ADC_PIN1, Vref1);
-  float voltage2 = readVoltage(ADC_PIN2, Vref2);
-
-  Serial.printf("Voltage 1 (Vin): %.2f V\n", voltage1);
-  Serial.printf("Voltage 2 (Bat): %.2f V\n", voltage2);
-
   // Put PMS to sleep
   sendPMSCommand(CMD_SLEEP);
-  delay(5000);
-
-  // Initialize SD Card Module
-  initSD();
-
-  // Log to Master SD Record (Offline & Online data)
-  logToSD("/testdata1124.csv", temperature, humidity, pm1_0, pm2_5, pm10,
-          voltage1, voltage2, (rtc.begin() ? &timeinfo : nullptr));
 
-  
-  bool currentUploadSuccess = false;
-
-  if (statusWiFi) {
-    Serial.println(F("📶 WiFi is Online. Checking for backlog..."));
+  if (uplink != UPLINK_NONE) {
+    // Join the network phase started above
+    xEventGroupWaitBits(cycleEvents, NET_DONE_BIT, pdFALSE, pdTRUE,
+                        portMAX_DELAY);
+  } else {
+    // The reading itself may be worth waking the radio for (PM spike,
+    // sensor fault); then the network phase runs here instead.
+    // Burst samples do not force it: they are flushed to the log below and
+    // go out with the next uplink, or a sustained episode would keep the
+    // radio on every wake
+    uplink = shouldConnect(record.pm25, packStatusFlags(), pending);
+    Serial.printf("📡 Uplink: %s (%u record(s) queued)\n",
+                  uplinkReasonName(uplink), (unsigned)pending);
+    if (uplink != UPLINK_NONE) {
+      networkPhase();
+    }
+  }
 
-    // Process Backlog (Upload missed data from previous offline cycles)
-    processBacklog("/backlog.csv");
+  // NTP time is when the sync ran; after a burst that is minutes past the
+  // reading, so the burst samples would sort before it
+  if (ntpOk && !burstCount()) {
+    timeinfo = ntpTime;
+  }
 
-    // B. Upload Current Data
-    sendToThingSpeak(temperature, humidity, pm1_0, pm2_5, pm10,
-                                      voltage1, voltage2);
-    sendToRenderBackend(temperature, humidity, pm1_0, pm2_5, pm10, voltage1,
-                            voltage2, &timeinfo);
+  // Without a channel id for bulk updates (or a log to replay from),
+  // ThingSpeak only gets live data, so it goes before logging and its
+  // result is captured in the record's status flags.
+  if (statusOk(STATUS_WIFI) && (!thingSpeakBulkEnabled() || !statusOk(STATUS_SD))) {
+    sendToThingSpeak(record);
+  }
 
+  // Buffer the reading in RTC memory; the card is only powered when the
+  // buffer is due for a flush or an upload needs the log.
+  finishRecord(record, rtc.begin() ? (uint32_t)mktime(&timeinfo) : 0);
+  rtcBufferPush(record);
+  aggregateAdd(record);
+
+  if (statusOk(STATUS_WIFI) || rtcBufferShouldFlush() || burstCount()) {
+    // Initialize SD Card Module (already mounted if the network phase ran)
+    profileBegin(PHASE_SD);
+    initSD();
+
+    // Log to Master SD Record (Offline & Online data)
+    if (statusOk(STATUS_SD)) {
+      // burst samples were taken after the reading, so they go after it
+      if (flushRtcBuffer(MASTER_LOG_FILE)) {
+        flushBurst(MASTER_LOG_FILE);
+      }
+      archiveLog(MASTER_LOG_FILE, ARCHIVE_DIR);
+    }
+    profileEnd(PHASE_SD);
+  }
 
-    if (statusRender) {
-      currentUploadSuccess = true;
+  if (statusOk(STATUS_WIFI)) {
+    if (statusOk(STATUS_SD)) {
+      // The backlog was replayed during warm-up; this sends the reading
+      // just flushed to every sink over the same connections.
+      profileBegin(PHASE_BACKLOG);
+      dispatchUploads(MASTER_LOG_FILE, true);
+      profileEnd(PHASE_BACKLOG);
+      pruneLog(MASTER_LOG_FILE);
+    } else {
+      // No log to replay from, send the current reading directly
+      sendToRenderBackend(record);
     }
+    finishUploads();
   } else {
-    Serial.println(F("⚠️ WiFi Offline. Skipping immediate upload."));
+    Serial.println(F("⚠️ WiFi Offline. Reading stays queued in RTC memory."));
   }
 
-  // 3. If Upload Failed or WiFi was down, Save to Backlog
-  if (!currentUploadSuccess) {
-    Serial.println(
-        F("💾 Saving current reading to backlog.csv for later upload."));
-    logToBacklog("/backlog.csv", temperature, humidity, pm1_0, pm2_5, pm10,
-                 voltage1, voltage2, (rtc.begin() ? &timeinfo : nullptr));
+  if (statusOk(STATUS_SD) && rtcBufferCount() == 0) {
+    rtcBufferNoteSd(true, pendingUploads(MASTER_LOG_FILE));
+  } else if (!statusOk(STATUS_SD)) {
+    rtcBufferNoteSd(false, rtcBufferSdPending());
   }
-
-  delay(5000);
+  recordUplinkResult(uplink != UPLINK_NONE,
+                     statusOk(STATUS_WIFI) && statusOk(STATUS_RENDER),
+                     record.pm25, record.status);
+  closeStorage();
 
   // --- Print final status before sleep ---
   printStatus();
+  printAggregates();
+  printProfile();
+  profileCommit();
 
   // --- Sleep scheduling ---
-  uint64_t activeTime = millis() - startTime;
-  uint64_t cycleTime = 30ULL * 60ULL * 1000ULL;
-
-  uint64_t sleepTime = 0;
-  if (activeTime < cycleTime) {
-    sleepTime = cycleTime - activeTime;
-  } else {
-    sleepTime = 10 * 1000ULL;
-  }
-
-  Serial.printf("⏱️ Active time: %.2f sec | Sleeping for %.2f sec to complete "
-                "30 min cycle\n",
-                activeTime / 1000.0, sleepTime / 1000.0);
+  Serial.printf("⏱️ Active time: %.2f sec\n", (millis() - startTime) / 1000.0);
+  ScheduleInput schedule = {rtcLocalSeconds(), (uint32_t)millis(),
+                            record.pm25, record.vin, record.battery};
+  uint64_t sleepTime = scheduleNextWake(schedule);
 
   Serial.flush();
 
@@ -1,34 +1,128 @@
+#include "aggregate.h"
+#include "compact.h"
 #include "config.h"
 #include "globals.h"
 #include "network.h"
-#include <ArduinoJson.h>
+#include "profiler.h"
+#include "sensors.h"
+#include "storage.h"
 #include <HTTPClient.h>
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 
 
+// ----- WIFI FAST RECONNECT -----
+// The last good AP and IP lease are kept in RTC memory across deep sleep.
+// The next wake joins that BSSID on its channel with a static IP, which
+// skips the scan and the DHCP exchange. After WIFI_CACHE_MAX_USES wakes the
+// lease is refreshed through DHCP in case the router handed it out again.
+#define WIFI_CACHE_MAGIC 0xA9F1C0DE
+#define WIFI_GOT_IP_BIT BIT0
+#define WIFI_DISCONNECTED_BIT BIT1
+
+struct WiFiCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t ip, gateway, subnet, dns;
+  uint16_t uses;
+};
+
+static RTC_DATA_ATTR WiFiCache wifiCache;
+static EventGroupHandle_t wifiEvents = nullptr;
+static StaticEventGroup_t wifiEventsBuffer;
+static WiFiStats wifiStats;
+
+static void onWiFiEvent(arduino_event_id_t event) {
+  if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+    xEventGroupSetBits(wifiEvents, WIFI_GOT_IP_BIT);
+  } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    xEventGroupSetBits(wifiEvents, WIFI_DISCONNECTED_BIT);
+  }
+}
+
+// Blocks until an IP is assigned or, with failFast, until the first
+// disconnect, instead of polling the status in fixed steps.
+static bool waitForIP(uint32_t timeoutMs, bool failFast) {
+  EventBits_t waitFor = WIFI_GOT_IP_BIT | (failFast ? WIFI_DISCONNECTED_BIT : 0);
+  EventBits_t bits = xEventGroupWaitBits(wifiEvents, waitFor, pdTRUE, pdFALSE,
+                                         pdMS_TO_TICKS(timeoutMs));
+  return (bits & WIFI_GOT_IP_BIT) != 0;
+}
+
+static void saveWiFiCache(bool keepUses) {
+  uint16_t uses = keepUses ? wifiCache.uses + 1 : 0;
+  memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+  wifiCache.channel = WiFi.channel();
+  wifiCache.ip = WiFi.localIP();
+  wifiCache.gateway = WiFi.gatewayIP();
+  wifiCache.subnet = WiFi.subnetMask();
+  wifiCache.dns = WiFi.dnsIP();
+  wifiCache.uses = uses;
+  wifiCache.magic = WIFI_CACHE_MAGIC;
+}
+
 void connectWiFi() {
-  Serial.print(F("Connecting to WiFi"));
-  WiFi.begin(SSID_NAME, WIFI_PASSWORD);
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+  uint32_t t0 = millis();
+
+  if (!wifiEvents) {
+    wifiEvents = xEventGroupCreateStatic(&wifiEventsBuffer);
+    WiFi.onEvent(onWiFiEvent);
   }
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println(F("\n✅ WiFi connected"));
-    statusWiFi = true;
-    configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
+  xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT);
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+
+  bool connected = false;
+  wifiStats.fastPath = false;
+
+  if (wifiCache.magic == WIFI_CACHE_MAGIC && wifiCache.uses < WIFI_CACHE_MAX_USES) {
+    Serial.printf("Connecting to WiFi (cached ch %d)", (int)wifiCache.channel);
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway),
+                IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+    WiFi.begin(SSID_NAME, WIFI_PASSWORD, wifiCache.channel, wifiCache.bssid);
+    connected = waitForIP(WIFI_FAST_TIMEOUT_MS, true);
+    wifiStats.fastPath = connected;
+
+    if (!connected) {
+      // AP moved or lease went stale: forget it and do a full scan + DHCP
+      Serial.print(F(" failed, scanning"));
+      profileRetry(PHASE_WIFI);
+      wifiCache.magic = 0;
+      WiFi.disconnect();
+      WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0),
+                  IPAddress((uint32_t)0));
+      xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT);
+    }
+  } else {
+    Serial.print(F("Connecting to WiFi"));
+  }
+
+  if (!connected) {
+    WiFi.begin(SSID_NAME, WIFI_PASSWORD);
+    connected = waitForIP(WIFI_CONNECT_TIMEOUT_MS, false);
+  }
+
+  wifiStats.connectMs = millis() - t0;
+
+  if (connected) {
+    Serial.printf("\n✅ WiFi connected in %u ms%s\n", (unsigned)wifiStats.connectMs,
+                  wifiStats.fastPath ? " (fast reconnect)" : "");
+    setStatus(STATUS_WIFI, true);
+    saveWiFiCache(wifiStats.fastPath);
   } else {
     Serial.println(F("\n⚠️ WiFi not connected — will use RTC if available"));
-    statusWiFi = false;
+    setStatus(STATUS_WIFI, false);
   }
 }
 
+const WiFiStats &getWiFiStats() { return wifiStats; }
+
 
 
-void sendToThingSpeak(float temp, float hum, int pm1, int pm25, int pm10, float vin, float battery) {
+void sendToThingSpeak(const LogRecord &rec) {
   if ((WiFi.status() == WL_CONNECTED)) {
     HTTPClient http;
     char url[250];
@@ -36,84 +130,477 @@ void sendToThingSpeak(float temp, float hum, int pm1, int pm25, int pm10, float
              "http://api.thingspeak.com/"
              "update?api_key=%s&field1=%.2f&field2=%.2f&field3=%d&field4=%d&"
              "field5=%d&field6=%f&field7=%f",
-             TS_API_KEY, temp, hum, pm1, pm25, pm10, vin, battery);
+             TS_API_KEY, rec.temp, rec.hum, rec.pm1, rec.pm25, rec.pm10,
+             rec.vin, rec.battery);
 
+    profileBegin(PHASE_THINGSPEAK);
     http.begin(url);
     int httpCode = http.GET();
 
     if (httpCode == 200) {
       Serial.println(F("✅ Data uploaded to ThingSpeak"));
-      statusThingSpeak = true;
+      setStatus(STATUS_THINGSPEAK, true);
     } else {
       Serial.printf("❌ Upload failed, code: %d\n", httpCode);
-      statusThingSpeak = false;
+      setStatus(STATUS_THINGSPEAK, false);
     }
     http.end();
+    profileEnd(PHASE_THINGSPEAK);
   } else {
     Serial.println(F("❌ WiFi not connected"));
-    statusThingSpeak = false;
+    setStatus(STATUS_THINGSPEAK, false);
   }
 }
 
-void sendToRenderBackend(float temp, float hum, int pm1, int pm25, int pm10,
-                         float vin, float battery, struct tm *timeinfo) {
-  if (WiFi.status() == WL_CONNECTED) {
-    WiFiClientSecure client;
-    client.setInsecure();
+// Set by formatCycleMeta: whether the meta it built carries the profile
+static bool metaHasProfile = false;
 
-    HTTPClient http;
-    http.begin(client, RENDER_URL);
-    // http.begin("http://192.168.137.1:8000/api/data");
-    http.addHeader("Content-Type", "application/json");
-    http.addHeader("x-api-key", SENSOR_API_KEY);
+// Facts about the current wake that are not part of any single reading.
+// Attached as "meta" to the upload that carries the newest record, with
+// the aggregates and the wake profile appended when they fit.
+static int formatCycleMeta(char *buf, size_t size) {
+  const PMSStats &pms = getPMSStats();
+  const PMSFrame &f = getLastPMSFrame();
+  int len = snprintf(buf, size,
+                     "{\"wifi_ms\":%u,\"wifi_fast\":%s,\"pms_warmup_ms\":%u,"
+                     "\"pms_frames\":%u,\"pms_converged\":%s,\"pms_bad\":%u,"
+                     "\"pm_cf1\":[%u,%u,%u],"
+                     "\"pm_counts\":[%u,%u,%u,%u,%u,%u]",
+                     (unsigned)wifiStats.connectMs,
+                     wifiStats.fastPath ? "true" : "false",
+                     (unsigned)pms.warmupMs, (unsigned)pms.frames,
+                     pms.converged ? "true" : "false", (unsigned)pms.badFrames,
+                     f.pm1Cf1, f.pm25Cf1, f.pm10Cf1, f.count03, f.count05,
+                     f.count10, f.count25, f.count50, f.count100);
+  // Optional parts, in order of importance; each one is left out whole
+  // if it does not fit. One byte is kept for the closing brace.
+  auto append = [&](const char *key, int (*format)(char *, size_t)) {
+    size_t keyLen = strlen(key);
+    if (len + keyLen + 1 >= size)
+      return false;
+    size_t room = size - len - keyLen - 1;
+    memcpy(buf + len, key, keyLen);
+    int n = format(buf + len + keyLen, room);
+    if (n <= 0 || (size_t)n >= room)
+      return false;
+    len += keyLen + n;
+    return true;
+  };
+  append(",\"agg\":", formatAggregates);
+  // The profile history is only cleared once it has actually gone out
+  metaHasProfile = append(",\"profile\":", formatProfile);
+  buf[len++] = '}';
+  buf[len] = '\0';
+  return len;
+}
 
-    JsonDocument jsonDoc;
+// ----- RENDER CONNECTION -----
+// One TLS client is shared by the current reading and the backlog replay.
+// HTTPClient runs with reuse enabled, so http.end() leaves the socket open
+// (keep-alive) and only the first request of a wake pays for the handshake.
+static WiFiClientSecure renderClient;
+static HTTPClient renderHttp;
+static UploadTiming uploadTiming;
 
-    jsonDoc["temp"] = temp;
-    jsonDoc["hum"] = hum;
-    jsonDoc["pm1"] = pm1;
-    jsonDoc["pm25"] = pm25;
-    jsonDoc["pm10"] = pm10;
+// Opens the TLS connection ahead of the first request so the handshake
+// can be timed separately from the HTTP exchange.
+static bool openRenderConnection() {
+  if (renderClient.connected())
+    return true;
 
-    jsonDoc["battery"] = battery;
-    jsonDoc["vin"] = vin;
+  // RENDER_URL is "https://host[:port]/path"
+  const char *start = strstr(RENDER_URL, "://");
+  start = start ? start + 3 : RENDER_URL;
+  size_t hostLen = strcspn(start, ":/");
+  char host[96];
+  if (hostLen >= sizeof(host))
+    return false;
+  memcpy(host, start, hostLen);
+  host[hostLen] = '\0';
+  uint16_t port = start[hostLen] == ':' ? atoi(start + hostLen + 1) : 443;
 
-    if (timeinfo) {
-      jsonDoc["ts"] = mktime(timeinfo);
-    }
+  renderClient.setInsecure();
+  uint32_t t0 = millis();
+  bool ok = renderClient.connect(host, port);
+  uploadTiming.handshakeMs += millis() - t0;
+  uploadTiming.handshakes++;
+  if (!ok) {
+    Serial.printf("❌ TLS connect to %s failed\n", host);
+  }
+  return ok;
+}
+
+static void beginRenderRequest(const char *url,
+                               const char *contentType = "application/json") {
+  profileBegin(PHASE_UPLOAD);
+  openRenderConnection();
+  renderHttp.setReuse(true);
+  renderHttp.begin(renderClient, url);
+  renderHttp.addHeader("Content-Type", contentType);
+  renderHttp.addHeader("x-api-key", SENSOR_API_KEY);
+}
+
+// Keeps the connection open for the next request of this wake.
+static void endRenderRequest(uint32_t requestStart) {
+  renderHttp.end();
+  uploadTiming.requestMs += millis() - requestStart;
+  uploadTiming.requests++;
+  profileEnd(PHASE_UPLOAD);
+}
+
+void closeRenderConnection() {
+  renderClient.stop();
+  Serial.printf("🔐 Render: %u handshake(s) %u ms, %u request(s) %u ms\n",
+                uploadTiming.handshakes, (unsigned)uploadTiming.handshakeMs,
+                uploadTiming.requests, (unsigned)uploadTiming.requestMs);
+}
+
+const UploadTiming &getUploadTiming() { return uploadTiming; }
+
+// Formats one record as a JSON object matching schemas.AQMSFullDataCreate.
+// NaN sensor values become null so a single bad reading cannot make the
+// whole batch unparseable.
+static const size_t RECORD_JSON_MAX = 320;
+static_assert(COMPACT_RECORD_MAX <= RECORD_JSON_MAX, "batch chunk too small");
 
-    jsonDoc["aht20"] = statusAHT;
-    jsonDoc["rtc"] = statusRTC;
-    jsonDoc["pms7003"] = statusPMS;
-    jsonDoc["wifi"] = statusWiFi;
-    jsonDoc["ntp"] = statusNTP;
-    jsonDoc["sdcard"] = statusSD;
-    jsonDoc["thingspeak"] = statusThingSpeak;
+static int formatRecordJson(const LogRecord &rec, char *buf, size_t size) {
+  char t[16], h[16], b[16], v[16];
+  auto fmt = [](char *out, float x) {
+    if (isnan(x))
+      strcpy(out, "null");
+    else
+      snprintf(out, 16, "%.2f", x);
+  };
+  fmt(t, rec.temp);
+  fmt(h, rec.hum);
+  fmt(b, rec.battery);
+  fmt(v, rec.vin);
 
-    String body;
-    serializeJson(jsonDoc, body);
+  auto flag = [&](uint16_t bit) { return (rec.status & bit) ? "true" : "false"; };
+  return snprintf(buf, size,
+                  "{\"ts\":%u,\"temp\":%s,\"hum\":%s,\"pm1\":%d,\"pm25\":%d,"
+                  "\"pm10\":%d,\"battery\":%s,\"vin\":%s,\"aht20\":%s,"
+                  "\"rtc\":%s,\"pms7003\":%s,\"wifi\":%s,\"ntp\":%s,"
+                  "\"sdcard\":%s,\"thingspeak\":%s,\"burst\":%s,\"seq\":%u}",
+                  (unsigned)rec.ts, t, h, rec.pm1, rec.pm25, rec.pm10, b, v,
+                  flag(STATUS_AHT), flag(STATUS_RTC), flag(STATUS_PMS),
+                  flag(STATUS_WIFI), flag(STATUS_NTP), flag(STATUS_SD),
+                  flag(STATUS_THINGSPEAK), flag(STATUS_BURST),
+                  (unsigned)rec.seq);
+}
 
-    int code = http.POST(body);
+void sendToRenderBackend(const LogRecord &rec) {
+  if (WiFi.status() == WL_CONNECTED) {
+    HTTPClient &http = renderHttp;
+    beginRenderRequest(RENDER_URL);
+    uint32_t requestStart = millis();
+
+    // The same object a batch carries per record, with meta spliced in
+    // before the closing brace. Built on the stack: no heap while TLS is up.
+    char body[RECORD_JSON_MAX + CYCLE_META_MAX + 16];
+    int len = formatRecordJson(rec, body, RECORD_JSON_MAX);
+    metaHasProfile = false;
+    if (len > 0 && len < (int)RECORD_JSON_MAX) {
+      const char key[] = ",\"meta\":";
+      memcpy(body + len - 1, key, sizeof(key));
+      len += sizeof(key) - 2;
+      len += formatCycleMeta(body + len, sizeof(body) - len - 1);
+      body[len++] = '}';
+      body[len] = '\0';
+    }
+
+    int code = http.POST((const uint8_t *)body, len);
 
     // Render wakeup handling
     if (code == 503) {
       Serial.println("⚠️ Render backend waking... retrying in 3s...");
       delay(3000);
-      code = http.POST(body);
+      profileRetry(PHASE_UPLOAD);
+      code = http.POST((const uint8_t *)body, len);
     }
 
     if (code == 200 || code == 201) {
       Serial.println("✅ Data uploaded to Render");
-      statusRender = true;
+      setStatus(STATUS_RENDER, true);
+      if (metaHasProfile)
+        profileSent();
     } else {
       Serial.printf("❌ Upload failed, code: %d\n", code);
       Serial.println(body);
-      statusRender = false;
+      setStatus(STATUS_RENDER, false);
     }
 
-    http.end();
+    endRenderRequest(requestStart);
   } else {
     Serial.println("❌ WiFi not connected");
-    statusRender = false;
+    setStatus(STATUS_RENDER, false);
   }
-}
\ No newline at end of file
+}
+
+// ----- BATCH UPLOAD -----
+
+// Body layouts RecordBatchStream can produce
+enum BatchFormat {
+  BATCH_JSON,      // {"records":[...],"meta":{...}} for Render
+  BATCH_CBOR,      // the same in CBOR, see compact.h
+  BATCH_THINGSPEAK // ThingSpeak bulk_update.json, no meta
+};
+
+// Formats one record as a ThingSpeak bulk update entry. Fields match the
+// live update; missing readings are left out rather than sent as zero.
+// Returns 0 for a record without a timestamp, which ThingSpeak would file
+// under the time of the upload.
+static int formatThingSpeakJson(const LogRecord &rec, char *buf, size_t size) {
+  if (rec.ts == 0)
+    return 0;
+  time_t ts = rec.ts;
+  struct tm t;
+  gmtime_r(&ts, &t);
+  int len = strftime(buf, size, "{\"created_at\":\"%Y-%m-%dT%H:%M:%SZ\"", &t);
+
+  auto real = [&](int field, float x) {
+    if (!isnan(x))
+      len += snprintf(buf + len, size - len, ",\"field%d\":%.2f", field, x);
+  };
+  auto whole = [&](int field, int x) {
+    if (x >= 0)
+      len += snprintf(buf + len, size - len, ",\"field%d\":%d", field, x);
+  };
+  real(1, rec.temp);
+  real(2, rec.hum);
+  whole(3, rec.pm1);
+  whole(4, rec.pm25);
+  whole(5, rec.pm10);
+  real(6, rec.vin);
+  real(7, rec.battery);
+  len += snprintf(buf + len, size - len, "}");
+  return len;
+}
+
+// Produces the body for one batch from a range of the master log, reading
+// one record at a time from SD while HTTPClient pulls it. Records that
+// fail their CRC are left out; meta is only sent with the Render batch that
+// ends at the newest record.
+class RecordBatchStream : public Stream {
+public:
+  RecordBatchStream(File &log, uint32_t first, uint32_t count,
+                    BatchFormat format, bool withMeta)
+      : log(log), first(first), end(first + count), format(format) {
+    metaLen = withMeta && format != BATCH_THINGSPEAK
+                  ? formatCycleMeta(meta, sizeof(meta) - 1)
+                  : 0;
+    // JSON: stored with the body's closing brace so it can be sent as is
+    if (metaLen && format == BATCH_JSON)
+      meta[metaLen++] = '}';
+    rewind();
+  }
+
+  void rewind() {
+    next = first;
+    emitted = 0;
+    stage = 0;
+    pos = len = 0;
+    out = chunk;
+    compactReset(deltas);
+  }
+
+  // Total body size, found by running the generator once without sending.
+  size_t measure() {
+    size_t total = 0;
+    while (fill())
+      total += len, pos = len;
+    encodable = emitted;
+    rewind();
+    return total;
+  }
+
+  // Records in the body, once measure() has run
+  uint32_t records() const { return encodable; }
+
+  int available() override { return fill() ? len - pos : 0; }
+  int read() override { return fill() ? (uint8_t)out[pos++] : -1; }
+  int peek() override { return fill() ? (uint8_t)out[pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  File &log;
+  uint32_t first, end, next, emitted;
+  uint32_t encodable = 0;
+  BatchFormat format;
+  CompactState deltas;
+  int stage; // 0 = prefix, 1 = records, 2 = suffix, 3 = meta, 4 = done
+  char chunk[RECORD_JSON_MAX]; // one record, JSON or CBOR
+  char meta[CYCLE_META_MAX];
+  size_t metaLen;
+  const char *out; // chunk, or meta while it is being sent
+  size_t pos, len;
+
+  bool fill() {
+    if (pos < len)
+      return true;
+    pos = len = 0;
+    out = chunk;
+    uint8_t *bin = (uint8_t *)chunk;
+    while (len == 0) {
+      if (stage == 0) {
+        if (format == BATCH_CBOR) {
+          // {0: version, 1: [_ ... (records follow)
+          bin[len++] = 0xA0 | (metaLen ? 3 : 2);
+          len += cborInt(0, bin + len);
+          len += cborInt(COMPACT_VERSION, bin + len);
+          len += cborInt(1, bin + len);
+          bin[len++] = 0x9F;
+        } else if (format == BATCH_THINGSPEAK) {
+          len = snprintf(chunk, sizeof(chunk),
+                         "{\"write_api_key\":\"%s\",\"updates\":[", TS_API_KEY);
+        } else {
+          len = snprintf(chunk, sizeof(chunk), "{\"records\":[");
+        }
+        stage = 1;
+      } else if (stage == 1) {
+        if (next >= end) {
+          stage = 2;
+          continue;
+        }
+        LogRecord rec;
+        if (!readRecord(log, next++, rec))
+          continue;
+        if (format == BATCH_CBOR) {
+          len = compactEncodeRecord(rec, deltas, bin);
+          continue;
+        }
+        size_t sep = emitted ? 1 : 0;
+        chunk[0] = ',';
+        int n = format == BATCH_THINGSPEAK
+                    ? formatThingSpeakJson(rec, chunk + sep, sizeof(chunk) - sep)
+                    : formatRecordJson(rec, chunk + sep, sizeof(chunk) - sep);
+        if (n > 0) {
+          len = sep + n;
+          emitted++;
+        }
+      } else if (stage == 2) {
+        if (format == BATCH_CBOR) {
+          bin[len++] = 0xFF; // end of records
+          if (metaLen) {
+            len += cborInt(2, bin + len);
+            len += cborHead(3, metaLen, bin + len); // text string
+          }
+        } else {
+          len = snprintf(chunk, sizeof(chunk), metaLen ? "],\"meta\":" : "]}");
+        }
+        stage = metaLen ? 3 : 4;
+      } else if (stage == 3) {
+        out = meta;
+        len = metaLen;
+        stage = 4;
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+bool sendBatchToRenderBackend(File &log, uint32_t first, uint32_t count,
+                              bool withMeta, size_t &bytesSent) {
+  bytesSent = 0;
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("❌ WiFi not connected");
+    setStatus(STATUS_RENDER, false);
+    return false;
+  }
+
+  char url[160];
+  snprintf(url, sizeof(url), "%s%s", RENDER_URL, RENDER_BATCH_PATH);
+
+  RecordBatchStream body(log, first, count,
+                         RENDER_COMPACT_UPLOAD ? BATCH_CBOR : BATCH_JSON,
+                         withMeta);
+  size_t length = body.measure();
+
+  HTTPClient &http = renderHttp;
+  beginRenderRequest(url, RENDER_COMPACT_UPLOAD ? COMPACT_CONTENT_TYPE
+                                                : "application/json");
+  uint32_t requestStart = millis();
+
+  int code = http.sendRequest("POST", &body, length);
+
+  // Render wakeup handling
+  if (code == 503) {
+    Serial.println("⚠️ Render backend waking... retrying in 3s...");
+    delay(3000);
+    profileRetry(PHASE_UPLOAD);
+    body.rewind();
+    code = http.sendRequest("POST", &body, length);
+  }
+
+  if (code == 200 || code == 201) {
+    Serial.printf("✅ Batch of %u record(s) uploaded (%u bytes)\n",
+                  (unsigned)count, (unsigned)length);
+    setStatus(STATUS_RENDER, true);
+    bytesSent = length;
+    if (withMeta && metaHasProfile)
+      profileSent();
+  } else {
+    Serial.printf("❌ Batch upload failed, code: %d\n", code);
+    setStatus(STATUS_RENDER, false);
+  }
+
+  endRenderRequest(requestStart);
+  return statusOk(STATUS_RENDER);
+}
+
+// ----- THINGSPEAK BULK UPDATE -----
+// Replays the log through the bulk_update.json API of the channel given by
+// the THINGSPEAK_CHANNEL_ID build flag. Plain HTTP like the live update, on
+// its own keep-alive connection so it can run next to the Render upload.
+static WiFiClient thingSpeakClient;
+static HTTPClient thingSpeakHttp;
+
+bool thingSpeakBulkEnabled() { return TS_CHANNEL_ID[0] != '\0'; }
+
+bool sendBatchToThingSpeak(File &log, uint32_t first, uint32_t count,
+                           bool /*withMeta*/, size_t &bytesSent) {
+  bytesSent = 0;
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("❌ WiFi not connected");
+    setStatus(STATUS_THINGSPEAK, false);
+    return false;
+  }
+
+  char url[96];
+  snprintf(url, sizeof(url),
+           "http://api.thingspeak.com/channels/%s/bulk_update.json",
+           TS_CHANNEL_ID);
+
+  RecordBatchStream body(log, first, count, BATCH_THINGSPEAK, false);
+  size_t length = body.measure();
+  // Nothing ThingSpeak can file (no timestamps, bad CRCs): the range is
+  // done, or the cursor would stay on it for good
+  if (body.records() == 0) {
+    Serial.printf("⚠️ ThingSpeak: none of %u record(s) can be filed, skipped\n",
+                  (unsigned)count);
+    return true;
+  }
+
+  profileBegin(PHASE_THINGSPEAK);
+  thingSpeakHttp.setReuse(true);
+  thingSpeakHttp.begin(thingSpeakClient, url);
+  thingSpeakHttp.addHeader("Content-Type", "application/json");
+  int code = thingSpeakHttp.sendRequest("POST", &body, length);
+
+  if (code == 200 || code == 202) {
+    Serial.printf("✅ ThingSpeak bulk update of %u record(s) (%u bytes)\n",
+                  (unsigned)count, (unsigned)length);
+    setStatus(STATUS_THINGSPEAK, true);
+    bytesSent = length;
+  } else {
+    Serial.printf("❌ ThingSpeak bulk update failed, code: %d\n", code);
+    setStatus(STATUS_THINGSPEAK, false);
+  }
+  thingSpeakHttp.end();
+  profileEnd(PHASE_THINGSPEAK);
+  return statusOk(STATUS_THINGSPEAK);
+}
+
+void closeThingSpeakConnection() { thingSpeakClient.stop(); }
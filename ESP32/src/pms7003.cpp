@@ -0,0 +1,106 @@
+#include "pms7003.h"
+#include <string.h>
+
+static uint16_t word(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+void PMSParser::reset() {
+  state = WAIT_START1;
+  have = 0;
+  expect = 0;
+}
+
+bool PMSParser::feed(uint8_t b) { return step(b); }
+
+bool PMSParser::step(uint8_t b) {
+  switch (state) {
+  case WAIT_START1:
+    if (b == 0x42) {
+      buf[0] = b;
+      have = 1;
+      state = WAIT_START2;
+    } else {
+      skippedBytes++;
+    }
+    return false;
+
+  case WAIT_START2:
+    if (b == 0x4D) {
+      buf[have++] = b;
+      state = LENGTH;
+    } else {
+      skippedBytes++;
+      reset();
+      return step(b); // this byte may itself start a frame
+    }
+    return false;
+
+  case LENGTH:
+    buf[have++] = b;
+    if (have == 4) {
+      size_t len = word(buf + 2);
+      if (len < 4 || len + 4 > MAX_FRAME) {
+        lengthErrors++;
+        resync();
+        return false;
+      }
+      expect = len + 4;
+      state = BODY;
+    }
+    return false;
+
+  case BODY:
+    buf[have++] = b;
+    if (have == expect)
+      return finishFrame();
+    return false;
+  }
+  return false;
+}
+
+bool PMSParser::finishFrame() {
+  uint16_t sum = 0;
+  for (size_t i = 0; i < expect - 2; i++)
+    sum += buf[i];
+
+  if (sum != word(buf + expect - 2)) {
+    checksumErrors++;
+    resync();
+    return false;
+  }
+
+  bool data = expect == MAX_FRAME;
+  if (data) {
+    const uint8_t *d = buf + 4;
+    lastFrame.pm1Cf1 = word(d + 0);
+    lastFrame.pm25Cf1 = word(d + 2);
+    lastFrame.pm10Cf1 = word(d + 4);
+    lastFrame.pm1Atm = word(d + 6);
+    lastFrame.pm25Atm = word(d + 8);
+    lastFrame.pm10Atm = word(d + 10);
+    lastFrame.count03 = word(d + 12);
+    lastFrame.count05 = word(d + 14);
+    lastFrame.count10 = word(d + 16);
+    lastFrame.count25 = word(d + 18);
+    lastFrame.count50 = word(d + 20);
+    lastFrame.count100 = word(d + 22);
+    lastFrame.version = d[24];
+    lastFrame.errorCode = d[25];
+    frames++;
+  }
+  reset();
+  return data;
+}
+
+// A bad length or checksum means the header was a false match inside
+// some other frame. Re-scan everything after that 0x42 so a real frame
+// starting in the buffered bytes is not lost. The replayed bytes are fewer
+// than a data frame, so they can never complete one here.
+void PMSParser::resync() {
+  uint8_t pending[MAX_FRAME];
+  size_t n = have > 1 ? have - 1 : 0;
+  memcpy(pending, buf + 1, n);
+  skippedBytes++;
+  reset();
+  for (size_t i = 0; i < n; i++)
+    step(pending[i]);
+}
@@ -0,0 +1,184 @@
+#include "profiler.h"
+#include "config.h"
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+
+static const char *const PHASE_NAMES[PHASE_COUNT] = {
+    "init", "aht", "wifi", "ntp", "pms", "adc", "sd", "backlog", "upload",
+    "thingspeak", "burst"};
+
+// This wake only
+struct PhaseTimer {
+  int64_t startUs; // 0 while not running
+  uint32_t totalUs;
+  uint8_t runs;
+  uint8_t retries;
+};
+
+static PhaseTimer phases[PHASE_COUNT];
+static uint32_t largestBlockLow = UINT32_MAX;
+
+// Kept in RTC memory: wakes since the last upload that carried a profile.
+// Bucket b counts phase durations below PROFILE_BUCKET_BASE_MS << b; the
+// last bucket takes everything longer.
+struct ProfileHistory {
+  uint32_t magic;
+  uint16_t cycles;
+  uint16_t hist[PHASE_COUNT][PROFILE_BUCKETS];
+  uint32_t lastMs[PHASE_COUNT]; // previous complete wake
+  uint8_t lastRuns[PHASE_COUNT];
+  uint8_t lastRetries[PHASE_COUNT];
+  uint32_t lastActiveMs;
+  uint32_t heapLow;  // lowest free heap seen by any wake in the window
+  uint32_t blockLow; // smallest largest-free-block seen
+  uint16_t sentCycles; // cycles covered by the last formatted profile
+};
+
+static const uint32_t PROFILE_MAGIC = 0x50524632; // "PRF2", per PHASE_COUNT
+static RTC_DATA_ATTR ProfileHistory history;
+
+static void resetHistory() {
+  memset(&history, 0, sizeof(history));
+  history.magic = PROFILE_MAGIC;
+  history.heapLow = UINT32_MAX;
+  history.blockLow = UINT32_MAX;
+}
+
+static uint8_t bucketFor(uint32_t ms) {
+  uint8_t b = 0;
+  while (b < PROFILE_BUCKETS - 1 && ms >= (PROFILE_BUCKET_BASE_MS << b))
+    b++;
+  return b;
+}
+
+void profileBegin(ProfilePhase phase) {
+  phases[phase].startUs = esp_timer_get_time();
+}
+
+void profileEnd(ProfilePhase phase) {
+  PhaseTimer &t = phases[phase];
+  if (!t.startUs)
+    return;
+  t.totalUs += esp_timer_get_time() - t.startUs;
+  t.startUs = 0;
+  if (t.runs < UINT8_MAX)
+    t.runs++;
+
+  uint32_t block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (block < largestBlockLow)
+    largestBlockLow = block;
+}
+
+void profileRetry(ProfilePhase phase) {
+  if (phases[phase].retries < UINT8_MAX)
+    phases[phase].retries++;
+}
+
+// Prints "[a,b,c]" with trailing zeros dropped
+static int formatArray(char *buf, size_t size, const uint32_t *v, size_t n) {
+  while (n && !v[n - 1])
+    n--;
+  int len = snprintf(buf, size, "[");
+  for (size_t i = 0; i < n && len < (int)size; i++)
+    len += snprintf(buf + len, size - len, i ? ",%u" : "%u", (unsigned)v[i]);
+  if (len < (int)size)
+    len += snprintf(buf + len, size - len, "]");
+  return len;
+}
+
+int formatProfile(char *buf, size_t size) {
+  if (history.magic != PROFILE_MAGIC)
+    resetHistory();
+
+  uint32_t ms[PHASE_COUNT], runs[PHASE_COUNT], retries[PHASE_COUNT];
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    ms[p] = history.lastMs[p];
+    runs[p] = history.lastRuns[p];
+    retries[p] = history.lastRetries[p];
+  }
+
+  int len = snprintf(buf, size, "{\"v\":1,\"cycles\":%u,\"active_ms\":%u,\"ms\":",
+                     history.cycles, (unsigned)history.lastActiveMs);
+  if (len < (int)size)
+    len += formatArray(buf + len, size - len, ms, PHASE_COUNT);
+  if (len < (int)size) {
+    len += snprintf(buf + len, size - len, ",\"n\":");
+    len += formatArray(buf + len, size - len, runs, PHASE_COUNT);
+  }
+  if (len < (int)size) {
+    len += snprintf(buf + len, size - len, ",\"retry\":");
+    len += formatArray(buf + len, size - len, retries, PHASE_COUNT);
+  }
+  if (len < (int)size) {
+    len += snprintf(buf + len, size - len, ",\"heap_min\":%u,\"heap_blk\":%u,\"hist\":[",
+                    history.heapLow == UINT32_MAX ? 0 : (unsigned)history.heapLow,
+                    history.blockLow == UINT32_MAX ? 0 : (unsigned)history.blockLow);
+  }
+  for (int p = 0; p < PHASE_COUNT && len < (int)size; p++) {
+    uint32_t counts[PROFILE_BUCKETS];
+    for (int b = 0; b < PROFILE_BUCKETS; b++)
+      counts[b] = history.hist[p][b];
+    if (p)
+      len += snprintf(buf + len, size - len, ",");
+    if (len < (int)size)
+      len += formatArray(buf + len, size - len, counts, PROFILE_BUCKETS);
+  }
+  if (len < (int)size)
+    len += snprintf(buf + len, size - len, "]}");
+
+  // Only a complete object is sent; a truncated one must not clear the window
+  history.sentCycles = len < (int)size ? history.cycles : 0;
+  return len;
+}
+
+void profileSent() {
+  if (history.magic != PROFILE_MAGIC || !history.sentCycles)
+    return;
+  // The whole window went out with the upload, so it starts over
+  memset(history.hist, 0, sizeof(history.hist));
+  history.cycles = 0;
+  history.sentCycles = 0;
+  history.heapLow = UINT32_MAX;
+  history.blockLow = UINT32_MAX;
+}
+
+void profileCommit() {
+  if (history.magic != PROFILE_MAGIC)
+    resetHistory();
+
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    PhaseTimer &t = phases[p];
+    if (t.startUs)
+      profileEnd((ProfilePhase)p); // still running, e.g. left by an early return
+    history.lastMs[p] = t.totalUs / 1000;
+    history.lastRuns[p] = t.runs;
+    history.lastRetries[p] = t.retries;
+    if (t.runs) {
+      uint16_t &slot = history.hist[p][bucketFor(t.totalUs / 1000)];
+      if (slot < UINT16_MAX)
+        slot++;
+    }
+  }
+  history.lastActiveMs = esp_timer_get_time() / 1000;
+  if (history.cycles < UINT16_MAX)
+    history.cycles++;
+
+  uint32_t heapLow = esp_get_minimum_free_heap_size();
+  if (heapLow < history.heapLow)
+    history.heapLow = heapLow;
+  if (largestBlockLow < history.blockLow)
+    history.blockLow = largestBlockLow;
+}
+
+void printProfile() {
+  Serial.print(F("⏱️ Phases (ms):"));
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    if (phases[p].runs)
+      Serial.printf(" %s %u%s", PHASE_NAMES[p], (unsigned)(phases[p].totalUs / 1000),
+                    phases[p].retries ? "*" : "");
+  }
+  Serial.printf("\n🧠 Heap: min free %u B, largest block %u B\n",
+                (unsigned)esp_get_minimum_free_heap_size(),
+                largestBlockLow == UINT32_MAX ? 0 : (unsigned)largestBlockLow);
+}
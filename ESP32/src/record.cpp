@@ -0,0 +1,69 @@
+#include "record.h"
+#include "globals.h"
+
+uint16_t crc16(const uint8_t *data, size_t len) {
+  // CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+  uint16_t crc = 0xFFFF;
+  while (len--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Survives deep sleep; a reset restarts it, which the backend sees as a gap
+static RTC_DATA_ATTR uint16_t nextSeq = 0;
+
+uint16_t packStatusFlags() {
+  return deviceStatus & (STATUS_AHT | STATUS_RTC | STATUS_PMS | STATUS_WIFI |
+                         STATUS_NTP | STATUS_SD | STATUS_THINGSPEAK |
+                         STATUS_RENDER);
+}
+
+void beginRecord(LogRecord &rec) {
+  memset(&rec, 0, sizeof(rec));
+  rec.temp = rec.hum = rec.vin = rec.battery = NAN;
+  rec.pm1 = rec.pm25 = rec.pm10 = -1;
+  rec.seq = nextSeq++; // numbered when taken, so burst samples follow
+}
+
+void finishRecord(LogRecord &rec, uint32_t ts, uint16_t extraStatus) {
+  rec.ts = ts;
+  rec.status = packStatusFlags() | extraStatus;
+  sealRecord(rec);
+}
+
+void sealRecord(LogRecord &rec) {
+  rec.crc = crc16((const uint8_t *)&rec, sizeof(rec) - sizeof(rec.crc));
+}
+
+bool recordValid(const LogRecord &rec) {
+  return rec.crc == crc16((const uint8_t *)&rec, sizeof(rec) - sizeof(rec.crc));
+}
+
+void initLogHeader(LogHeader &hdr, uint32_t created) {
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, LOG_MAGIC, sizeof(hdr.magic));
+  hdr.version = LOG_VERSION;
+  hdr.recordSize = sizeof(LogRecord);
+  hdr.logId = esp_random();
+  hdr.created = created;
+  hdr.crc = crc16((const uint8_t *)&hdr, sizeof(hdr) - sizeof(hdr.crc));
+}
+
+bool logCursor(const LogHeader &hdr, uint32_t storedId, uint32_t &cursor) {
+  if (storedId == hdr.logId)
+    return true;
+  if (!hdr.prevLogId || storedId != hdr.prevLogId)
+    return false;
+  cursor = cursor > hdr.base ? cursor - hdr.base : 0;
+  return true;
+}
+
+bool logHeaderValid(const LogHeader &hdr) {
+  return memcmp(hdr.magic, LOG_MAGIC, sizeof(hdr.magic)) == 0 &&
+         hdr.version == LOG_VERSION && hdr.recordSize == sizeof(LogRecord) &&
+         hdr.crc == crc16((const uint8_t *)&hdr, sizeof(hdr) - sizeof(hdr.crc));
+}
@@ -1,11 +1,28 @@
+#include "config.h"
 #include "globals.h"
 #include "rtc.h"
+#include <Preferences.h>
+#include <esp_sntp.h>
 
+// The DS3231 keeps local time, but the C library starts every boot in UTC
+// and only learns the zone from configTime() once WiFi is up. Setting it
+// here makes mktime() of an RTC reading give the same unix time as an NTP
+// one, so records from offline wakes are not stamped hours off.
+static void applyTimezone() {
+  // POSIX TZ strings count the offset west of UTC, hence the inverted sign
+  long off = GMT_OFFSET_SEC + DAYLIGHT_OFFSET_SEC;
+  char tz[24];
+  snprintf(tz, sizeof(tz), "UTC%c%02ld:%02ld", off > 0 ? '-' : '+',
+           labs(off) / 3600, (labs(off) % 3600) / 60);
+  setenv("TZ", tz, 1);
+  tzset();
+}
 
 void initRTC() {
+  applyTimezone();
   if (!rtc.begin()) {
     Serial.println(F("❌ DS3231 RTC not found!"));
-    statusRTC = false;
+    setStatus(STATUS_RTC, false);
   } else {
     Serial.println(F("✅ DS3231 RTC initialized"));
     // Check if RTC lost power and needs setting (optional default)
@@ -14,53 +31,180 @@ void initRTC() {
       // sets to compile time as a placeholder if needed:
       // rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
     }
-    statusRTC = true;
+    setStatus(STATUS_RTC, true);
+  }
+}
+// ----- DRIFT MODEL -----
+// Kept in RTC memory, mirrored to NVS at every sync so a power cycle does
+// not forget the learned rate.
+#define CLOCK_MAGIC 0x434C4B31 // "CLK1"
+
+struct ClockModel {
+  uint32_t magic;
+  uint32_t syncedAt; // unix time of the last NTP comparison, 0 for none
+  uint32_t learnedS; // time the estimate covers, up to NTP_DRIFT_WINDOW_S
+  float ppm;         // DS3231 rate error, positive when it runs fast
+};
+
+static RTC_DATA_ATTR ClockModel clockModel;
+
+static const long LOCAL_OFFSET = GMT_OFFSET_SEC + DAYLIGHT_OFFSET_SEC;
+
+static ClockModel &model() {
+  if (clockModel.magic != CLOCK_MAGIC) {
+    Preferences prefs;
+    prefs.begin(CLOCK_NVS_NAMESPACE, true);
+    clockModel.syncedAt = prefs.getUInt("synced", 0);
+    clockModel.learnedS = prefs.getUInt("learned", 0);
+    clockModel.ppm = prefs.getFloat("ppm", 0);
+    prefs.end();
+    clockModel.magic = CLOCK_MAGIC;
   }
+  return clockModel;
+}
+
+static void saveModel() {
+  Preferences prefs;
+  prefs.begin(CLOCK_NVS_NAMESPACE, false);
+  prefs.putUInt("synced", clockModel.syncedAt);
+  prefs.putUInt("learned", clockModel.learnedS);
+  prefs.putFloat("ppm", clockModel.ppm);
+  prefs.end();
+}
+
+// Seconds the DS3231 has gained since the last sync, by the learned rate
+static float predictedDrift(uint32_t rawUnix) {
+  const ClockModel &m = model();
+  if (!m.syncedAt || rawUnix <= m.syncedAt)
+    return 0;
+  return m.ppm * 1e-6f * (rawUnix - m.syncedAt);
+}
+
+// How far the corrected time may be off: a second of rounding at the sync
+// plus what the rate is not known to
+static float errorBound(uint32_t rawUnix) {
+  const ClockModel &m = model();
+  float uncertainPpm = NTP_UNLEARNED_PPM;
+  if (m.learnedS)
+    uncertainPpm = min(NTP_UNLEARNED_PPM,
+                       NTP_DRIFT_MARGIN_PPM + 1e6f / m.learnedS);
+  return 1 + uncertainPpm * 1e-6f * (rawUnix - m.syncedAt);
+}
+
+static uint32_t correctedLocal(const DateTime &now) {
+  uint32_t local = now.unixtime();
+  return local - lroundf(predictedDrift(local - LOCAL_OFFSET));
+}
+
+// error: DS3231 minus NTP at ntpUnix, both read in whole seconds. The
+// previous sync set the DS3231 to NTP's whole second, which drops NTP's
+// fraction: on average it started half a second behind. Each span counts
+// by its length, so a second of rounding over a short one barely moves
+// the estimate.
+static void learnDrift(uint32_t ntpUnix, long error) {
+  ClockModel &m = model();
+  if (!m.syncedAt || ntpUnix <= m.syncedAt)
+    return;
+  uint32_t span = ntpUnix - m.syncedAt;
+  float sample = (error + 0.5f) * 1e6f / span;
+  if (fabsf(sample) > NTP_DRIFT_MAX_PPM)
+    return;
+  m.ppm = (m.ppm * m.learnedS + sample * span) / ((float)m.learnedS + span);
+  m.learnedS = min(m.learnedS + span, NTP_DRIFT_WINDOW_S);
+}
+
+bool rtcTimeTrusted() {
+  if (!statusOk(STATUS_RTC) || rtc.lostPower())
+    return false;
+  const ClockModel &m = model();
+  if (!m.syncedAt)
+    return false;
+  uint32_t raw = rtc.now().unixtime() - LOCAL_OFFSET;
+  return raw >= m.syncedAt && errorBound(raw) < NTP_MAX_ERROR_S;
 }
+
+bool ntpSyncDue() {
+  if (!rtcTimeTrusted())
+    return true;
+  const ClockModel &m = model();
+  uint32_t raw = rtc.now().unixtime() - LOCAL_OFFSET;
+  if (raw - m.syncedAt >= NTP_MAX_INTERVAL_S)
+    return true;
+  float bound = errorBound(raw);
+  Serial.printf("🕒 NTP not needed: RTC within %.1f s (drift %+.2f ppm, "
+                "synced %.1f h ago)\n",
+                bound, m.ppm, (raw - m.syncedAt) / 3600.0);
+  return false;
+}
+
 bool syncTimeAndRTC(struct tm &timeinfo) {
-  if (getLocalTime(&timeinfo, 5000)) {
-    statusNTP = true;
-    Serial.println(F("🌐 NTP time acquired:"));
-    Serial.printf("NTP: %04d-%02d-%02d %02d:%02d:%02d\n",
-                  timeinfo.tm_year + 1900, timeinfo.tm_mon + 1,
-                  timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min,
-                  timeinfo.tm_sec);
-
-    DateTime ntpDT(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1,
-                   timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min,
-                   timeinfo.tm_sec);
-    DateTime rtcDT = rtc.now();
-
-    long diff = (long)(ntpDT.unixtime() - rtcDT.unixtime());
-    if (rtc.lostPower()) {
-      Serial.println(F("RTC lost power — updating RTC from NTP"));
-      rtc.adjust(ntpDT);
-    } else if (abs(diff) > 5) {
-      Serial.printf("RTC drift detected (%.0f s). Updating RTC from NTP.\n",
-                    (double)diff);
-      rtc.adjust(ntpDT);
-    } else {
-      Serial.println(F("RTC is within 5s of NTP — no update needed."));
-    }
+  // getLocalTime() returns at once whenever the system clock is set, and
+  // that clock runs on through deep sleep off the RC oscillator. Only a
+  // completed SNTP exchange is worth comparing the DS3231 with.
+  configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
+  uint32_t t0 = millis();
+  while (sntp_get_sync_status() != SNTP_SYNC_STATUS_COMPLETED) {
+    if (millis() - t0 >= NTP_TIMEOUT_MS)
+      return false;
+    delay(10);
+  }
+  if (!getLocalTime(&timeinfo, 0))
+    return false;
+
+  setStatus(STATUS_NTP, true);
+  Serial.println(F("🌐 NTP time acquired:"));
+  Serial.printf("NTP: %04d-%02d-%02d %02d:%02d:%02d\n",
+                timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+                timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  if (!statusOk(STATUS_RTC))
     return true;
+
+  DateTime ntpDT(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1,
+                 timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min,
+                 timeinfo.tm_sec);
+  DateTime rtcDT = rtc.now();
+  uint32_t ntpUnix = ntpDT.unixtime() - LOCAL_OFFSET;
+  uint32_t rtcUnix = rtcDT.unixtime() - LOCAL_OFFSET;
+
+  long diff = (long)(rtcDT.unixtime() - ntpDT.unixtime());
+  bool lost = rtc.lostPower();
+  if (lost) {
+    Serial.println(F("RTC lost power — updating RTC from NTP"));
+  } else {
+    float predicted = predictedDrift(rtcUnix);
+    learnDrift(ntpUnix, diff);
+    Serial.printf("RTC off by %+ld s (model said %+.1f s), drift now "
+                  "%+.2f ppm\n",
+                  diff, predicted, model().ppm);
   }
-  return false;
+  // Set at every sync, so each span starts from the same known state
+  rtc.adjust(ntpDT);
+  clockModel.syncedAt = ntpUnix;
+  saveModel();
+  return true;
 }
 
 
 
 void getRTCTime(struct tm &timeinfo) {
-  if (statusRTC || rtc.begin()) {
-    DateTime now = rtc.now();
-    memset(&timeinfo, 0, sizeof(timeinfo));
-    timeinfo.tm_year = now.year() - 1900;
-    timeinfo.tm_mon = now.month() - 1;
-    timeinfo.tm_mday = now.day();
-    timeinfo.tm_hour = now.hour();
-    timeinfo.tm_min = now.minute();
-    timeinfo.tm_sec = now.second();
+  if (statusOk(STATUS_RTC) || rtc.begin()) {
+    // the DS3231 reading, less the drift predicted since the last sync
+    time_t local = correctedLocal(rtc.now());
+    gmtime_r(&local, &timeinfo);
     Serial.println(F("Using RTC time (Fallback)."));
   } else {
     Serial.println(F("RTC not available for fallback time."));
   }
-}
\ No newline at end of file
+}
+// DS3231 time as seconds since 1970 in local time (the chip keeps local
+// time), drift-corrected, or 0 without a working RTC
+uint32_t rtcLocalSeconds() {
+  if (!statusOk(STATUS_RTC))
+    return 0;
+  return correctedLocal(rtc.now());
+}
+
+uint32_t rtcUnixTime() {
+  uint32_t local = rtcLocalSeconds();
+  return local ? local - LOCAL_OFFSET : 0;
+}
@@ -0,0 +1,112 @@
+#include "rtcbuffer.h"
+#include "config.h"
+#include "storage.h"
+
+#define RTC_BUFFER_MAGIC 0x52544231 // "RTB1"
+
+struct RtcBuffer {
+  uint32_t magic;
+  uint16_t count;
+  uint8_t sdOk;
+  uint8_t reserved;
+  uint32_t sdPending;
+  LogRecord records[RTC_BUFFER_CAPACITY];
+  uint16_t crc; // over everything above
+};
+
+static_assert(sizeof(RtcBuffer) <= 4096, "RTC slow memory is only 8 KB");
+
+static RTC_DATA_ATTR RtcBuffer rtcBuffer;
+
+static uint16_t bufferCrc() {
+  // Only the used part of records[] is covered, so the cost tracks count
+  size_t len = offsetof(RtcBuffer, records) + rtcBuffer.count * sizeof(LogRecord);
+  return crc16((const uint8_t *)&rtcBuffer, len);
+}
+
+static void seal() { rtcBuffer.crc = bufferCrc(); }
+
+static void reset() {
+  memset(&rtcBuffer, 0, sizeof(rtcBuffer));
+  rtcBuffer.magic = RTC_BUFFER_MAGIC;
+  rtcBuffer.sdOk = true;
+  seal();
+}
+
+void initRtcBuffer() {
+  if (rtcBuffer.magic != RTC_BUFFER_MAGIC) {
+    reset(); // cold boot
+    return;
+  }
+  if (rtcBuffer.count > RTC_BUFFER_CAPACITY || rtcBuffer.crc != bufferCrc()) {
+    Serial.println(F("⚠️ RTC buffer corrupt, discarding it"));
+    reset();
+  }
+}
+
+void rtcBufferPush(const LogRecord &rec) {
+  if (rtcBuffer.count == RTC_BUFFER_CAPACITY) {
+    // SD has been failing long enough to fill the buffer: drop the oldest
+    memmove(&rtcBuffer.records[0], &rtcBuffer.records[1],
+            (RTC_BUFFER_CAPACITY - 1) * sizeof(LogRecord));
+    rtcBuffer.count--;
+    Serial.println(F("⚠️ RTC buffer full, oldest reading dropped"));
+  }
+  rtcBuffer.records[rtcBuffer.count++] = rec;
+  seal();
+}
+
+uint16_t rtcBufferCount() { return rtcBuffer.count; }
+
+bool rtcBufferShouldFlush() {
+  return rtcBuffer.count >= RTC_FLUSH_EVERY ||
+         rtcBuffer.count + RTC_BUFFER_HEADROOM >= RTC_BUFFER_CAPACITY;
+}
+
+// A flush cut short by a write error or a reset may have put the first
+// readings on the card already. They end at the log's newest record, so
+// whatever the buffer holds up to that one is dropped rather than written
+// twice.
+static void dropLogged(const char *logFile) {
+  LogRecord last;
+  if (!lastLogRecord(logFile, last))
+    return;
+  for (uint16_t i = rtcBuffer.count; i-- > 0;) {
+    if (memcmp(&rtcBuffer.records[i], &last, sizeof(last)) != 0)
+      continue;
+    uint16_t logged = i + 1;
+    memmove(&rtcBuffer.records[0], &rtcBuffer.records[logged],
+            (rtcBuffer.count - logged) * sizeof(LogRecord));
+    rtcBuffer.count -= logged;
+    seal();
+    Serial.printf("⚠️ %u buffered reading(s) were already in %s\n",
+                  (unsigned)logged, logFile);
+    return;
+  }
+}
+
+bool flushRtcBuffer(const char *logFile) {
+  if (rtcBuffer.count == 0)
+    return true;
+  dropLogged(logFile);
+  if (rtcBuffer.count == 0)
+    return true;
+  if (!appendRecords(logFile, rtcBuffer.records, rtcBuffer.count) ||
+      !flushLog())
+    return false; // keep them for the next attempt
+  Serial.printf("💾 Flushed %u buffered reading(s) to %s\n",
+                (unsigned)rtcBuffer.count, logFile);
+  rtcBuffer.count = 0;
+  seal();
+  return true;
+}
+
+void rtcBufferNoteSd(bool ok, uint32_t pending) {
+  rtcBuffer.sdOk = ok;
+  rtcBuffer.sdPending = pending;
+  seal();
+}
+
+bool rtcBufferSdHealthy() { return rtcBuffer.sdOk; }
+
+uint32_t rtcBufferSdPending() { return rtcBuffer.sdPending; }
@@ -0,0 +1,181 @@
+#include "scheduler.h"
+#include "config.h"
+
+#define SCHEDULER_MAGIC 0x53434832 // "SCH2"
+
+// Kept in RTC memory so the policy sees previous wakes
+struct SchedulerState {
+  uint32_t magic;
+  uint32_t lastLocal;   // local time of the previous reading, 0 if unknown
+  uint32_t interval;    // seconds, as chosen last wake
+  uint32_t targetLocal; // slot the last sleep aimed for, 0 if unaligned
+  uint32_t sleptMs;     // what was asked of the sleep timer
+  int32_t timerPpm;     // learned sleep timer error, + when sleeping long
+  uint32_t timerLearnedS; // sleep the estimate covers, up to SCHEDULE_TIMER_WINDOW_S
+  int16_t lastPm25;     // -1 until the first good reading
+  uint8_t fastLeft;     // fast wakes still to go
+  uint8_t stableWakes;  // consecutive flat readings
+  uint8_t batteryLevel; // 0 fine, 1 low, 2 critical
+};
+
+static RTC_DATA_ATTR SchedulerState schedState;
+
+static void resetState() {
+  memset(&schedState, 0, sizeof(schedState));
+  schedState.magic = SCHEDULER_MAGIC;
+  schedState.interval = SCHEDULE_NORMAL_S;
+  schedState.lastPm25 = -1;
+}
+
+// How late (or early) this wake came versus the slot it aimed for tells
+// the sleep timer's error; blend it into the running estimate. The DS3231
+// reads whole seconds, so a sample is up to half a second off whatever the
+// timer did: short sleeps are left out, and like the RTC drift model
+// (rtc.cpp) each sleep counts by its length.
+static void learnTimerError(const ScheduleInput &in) {
+  if (!schedState.targetLocal || !in.localNow || !schedState.sleptMs)
+    return;
+  if (schedState.sleptMs < SCHEDULE_TIMER_MIN_SLEEP_S * 1000)
+    return;
+  // the DS3231 reads whole seconds; assume the middle of the second
+  double wokeMs = in.localNow * 1000.0 + 500 - in.awakeMs;
+  double errorMs = wokeMs - schedState.targetLocal * 1000.0;
+  // an NTP correction of the DS3231 or a reset, not timer error
+  if (fabs(errorMs) > schedState.sleptMs * 0.05 || fabs(errorMs) > 120000)
+    return;
+
+  double sample = schedState.timerPpm + errorMs * 1e6 / schedState.sleptMs;
+  double span = schedState.sleptMs / 1000.0;
+  double learned = schedState.timerLearnedS;
+  schedState.timerPpm = (int32_t)lround(
+      (schedState.timerPpm * learned + sample * span) / (learned + span));
+  schedState.timerLearnedS =
+      min<uint32_t>(schedState.timerLearnedS + lround(span), SCHEDULE_TIMER_WINDOW_S);
+  Serial.printf("⏰ Woke %+.1f s from the slot, sleep timer %+ld ppm\n",
+                errorMs / 1000.0, (long)schedState.timerPpm);
+}
+
+static uint8_t batteryLevel(const ScheduleInput &in) {
+  // on mains the battery is charging, and below 1 V it is not fitted
+  if (!(in.vin < SCHEDULE_ON_BATTERY_VIN) || !(in.battery > 1.0f))
+    return 0;
+  uint8_t level = in.battery < SCHEDULE_BATTERY_CRITICAL_V ? 2
+                  : in.battery < SCHEDULE_BATTERY_LOW_V    ? 1
+                                                           : 0;
+  // only step back up once clear of the threshold
+  uint8_t prev = schedState.batteryLevel;
+  if (prev == 2 && in.battery <
+                       SCHEDULE_BATTERY_CRITICAL_V + SCHEDULE_BATTERY_HYSTERESIS_V)
+    level = 2;
+  else if (prev >= 1 && level == 0 &&
+           in.battery < SCHEDULE_BATTERY_LOW_V + SCHEDULE_BATTERY_HYSTERESIS_V)
+    level = 1;
+  return level;
+}
+
+// Updates the PM trend; returns the rise in µg/m³ per hour (0 if unknown)
+static float trackPm25(const ScheduleInput &in) {
+  if (in.pm25 < 0)
+    return 0;
+  float rise = 0;
+  if (schedState.lastPm25 >= 0) {
+    int delta = in.pm25 - schedState.lastPm25;
+    uint32_t elapsed = in.localNow > schedState.lastLocal && schedState.lastLocal
+                           ? in.localNow - schedState.lastLocal
+                           : schedState.interval;
+    rise = delta * 3600.0f / max<uint32_t>(elapsed, 60);
+    if (rise >= SCHEDULE_PM25_RISE_PER_H)
+      schedState.fastLeft = SCHEDULE_FAST_HOLD;
+    if (abs(delta) <= SCHEDULE_STABLE_PM25) {
+      if (schedState.stableWakes < 255)
+        schedState.stableWakes++;
+    } else {
+      schedState.stableWakes = 0;
+    }
+  }
+  schedState.lastPm25 = in.pm25;
+  return rise;
+}
+
+static ScheduleMode chooseMode(uint32_t &interval) {
+  bool rising = schedState.fastLeft > 0;
+  if (rising)
+    schedState.fastLeft--;
+
+  if (schedState.batteryLevel == 2) {
+    interval = SCHEDULE_CRITICAL_BATTERY_S;
+    return SCHED_CRITICAL_BATTERY;
+  }
+  if (schedState.batteryLevel == 1) {
+    interval = rising ? SCHEDULE_NORMAL_S : SCHEDULE_LOW_BATTERY_S;
+    return SCHED_LOW_BATTERY;
+  }
+  if (rising) {
+    interval = SCHEDULE_FAST_S;
+    return SCHED_FAST;
+  }
+  if (schedState.stableWakes >= SCHEDULE_STABLE_WAKES) {
+    interval = SCHEDULE_STABLE_S;
+    return SCHED_STABLE;
+  }
+  interval = SCHEDULE_NORMAL_S;
+  return SCHED_NORMAL;
+}
+
+uint64_t scheduleNextWake(const ScheduleInput &in) {
+  if (schedState.magic != SCHEDULER_MAGIC)
+    resetState();
+
+  learnTimerError(in);
+  schedState.batteryLevel = batteryLevel(in);
+  float rise = trackPm25(in);
+  uint32_t interval;
+  ScheduleMode mode = chooseMode(interval);
+  schedState.interval = interval;
+  schedState.lastLocal = in.localNow;
+
+  uint64_t sleepMs;
+  if (in.localNow) {
+    // first slot far enough ahead to be worth sleeping for
+    uint64_t nowMs = in.localNow * 1000ULL + 500;
+    uint32_t slot = (in.localNow / interval + 1) * interval;
+    while (slot * 1000ULL < nowMs + SCHEDULE_MIN_SLEEP_S * 1000ULL)
+      slot += interval;
+    uint64_t wantMs = slot * 1000ULL - nowMs;
+    sleepMs = (uint64_t)(wantMs * 1e6 / (1e6 + schedState.timerPpm));
+    schedState.targetLocal = slot;
+
+    time_t t = slot;
+    struct tm at;
+    gmtime_r(&t, &at); // slots are already in local time
+    Serial.printf("⏰ Schedule: %s, every %u s (PM2.5 %+.1f µg/m³/h), "
+                  "next wake %02d:%02d:%02d, sleeping %.1f s\n",
+                  scheduleModeName(mode), (unsigned)interval, rise, at.tm_hour,
+                  at.tm_min, at.tm_sec, sleepMs / 1000.0);
+  } else {
+    sleepMs = interval * 1000ULL > in.awakeMs + SCHEDULE_MIN_SLEEP_S * 1000ULL
+                  ? interval * 1000ULL - in.awakeMs
+                  : SCHEDULE_MIN_SLEEP_S * 1000ULL;
+    schedState.targetLocal = 0;
+    Serial.printf("⏰ Schedule: %s, every %u s, no clock: sleeping %.1f s "
+                  "unaligned\n",
+                  scheduleModeName(mode), (unsigned)interval, sleepMs / 1000.0);
+  }
+  schedState.sleptMs = sleepMs > UINT32_MAX ? UINT32_MAX : (uint32_t)sleepMs;
+  return sleepMs;
+}
+
+const char *scheduleModeName(ScheduleMode mode) {
+  switch (mode) {
+  case SCHED_FAST:
+    return "fast";
+  case SCHED_STABLE:
+    return "stable";
+  case SCHED_LOW_BATTERY:
+    return "low-battery";
+  case SCHED_CRITICAL_BATTERY:
+    return "critical-battery";
+  default:
+    return "normal";
+  }
+}
@@ -1,64 +1,55 @@
 #include "sensors.h"
+#include "pms7003.h"
 #include <Wire.h>
 #include<globals.h>
+#include <algorithm>
 
 
-void initSensors(){
+// ----- SENSOR DRIVERS -----
+bool Aht20Sensor::begin() {
   Wire.begin(21, 22); // SDA, SCL
 
-  // PMS Serial
-  pmsSerial.begin(9600, SERIAL_8N1, PMS_RX, PMS_TX);
-  delay(2000);
-
-  // --- AHT20 ---
-  bool ahtInitialized = false;
-  if (aht.begin()) {
-      ahtInitialized = true;
-  }
-  
-  if (!ahtInitialized) {
+  if (!aht.begin()) {
     Serial.println(F("❌ AHT20 not found"));
-    statusAHT = false;
-  } else {
-    Serial.println(F("✅ AHT20 initialized"));
-    statusAHT = true;
+    return false;
   }
+  Serial.println(F("✅ AHT20 initialized"));
+  return true;
 }
 
-
-
-void sendPMSCommand(const byte *cmd) {
-  pmsSerial.write(cmd, 7);
-  pmsSerial.flush();
+bool Aht20Sensor::read(LogRecord &rec) {
+  if (!statusOk(STATUS_AHT))
+    return false;
+  float humidity;
+  float temperature = readTemperature(humidity);
+  if (isnan(temperature) || isnan(humidity)) {
+    Serial.println(F("❌ Invalid AHT data"));
+    return false;
+  }
+  rec.temp = temperature;
+  rec.hum = humidity;
+  return true;
 }
 
-float readRawAverage(int pin, int samples = 30) {
-  long s = 0;
-  for (int i = 0; i < samples; i++) {
-    s += analogRead(pin);
-    delay(3);
-  }
-  return s / (float)samples;
+bool Pms7003Sensor::begin() {
+  // readPMData waits for the first frame, no settle delay needed
+  pmsSerial.begin(9600, SERIAL_8N1, PMS_RX, PMS_TX);
+  return true;
 }
 
-float readVoltage(int pin, float Vref_cal) {
-  float raw = readRawAverage(pin, 30);
-  float Vout = (raw / 4095.0) * Vref_cal;
-  float Vin = Vout / VOLTAGE_DIVIDER_RATIO;
-  return Vin;
+bool Pms7003Sensor::read(LogRecord &rec) {
+  int pm1_0, pm2_5, pm10;
+  if (!readPMData(pm1_0, pm2_5, pm10))
+    return false;
+  rec.pm1 = pm1_0;
+  rec.pm25 = pm2_5;
+  rec.pm10 = pm10;
+  return true;
 }
 
-void calibrateVref(int pin, float knownVin, float &Vref_cal) {
-  Serial.print("Calibrating Vref for pin ");
-  Serial.println(pin);
-  float raw = readRawAverage(pin, 50);
-  float Vout = knownVin * VOLTAGE_DIVIDER_RATIO;
-  Vref_cal = (Vout * 4095.0) / raw;
-  Serial.print("✔ New calibrated Vref for pin ");
-  Serial.print(pin);
-  Serial.print(" = ");
-  Serial.print(Vref_cal, 6);
-  Serial.println(" V");
+void sendPMSCommand(const byte *cmd) {
+  pmsSerial.write(cmd, 7);
+  pmsSerial.flush();
 }
 
 float readTemperature(float &humidityOut) {
@@ -70,29 +61,105 @@ float readTemperature(float &humidityOut) {
   return temp.temperature;
 }
 
+// ----- PMS7003 ADAPTIVE WARM-UP -----
+static PMSStats pmsStats;
+
+static PMSParser pmsParser;
+
+// Feeds pmsSerial into the frame decoder until it yields the next
+// checksummed data frame or the deadline passes.
+static bool readActiveFrame(uint16_t pm[3], uint32_t deadline) {
+  while ((int32_t)(deadline - millis()) > 0) {
+    if (!pmsSerial.available()) {
+      delay(10);
+      continue;
+    }
+    if (pmsParser.feed(pmsSerial.read())) {
+      const PMSFrame &f = pmsParser.frame();
+      pm[0] = f.pm1Atm;
+      pm[1] = f.pm25Atm;
+      pm[2] = f.pm10Atm;
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint16_t median(const uint16_t *v, size_t n) {
+  uint16_t s[PMS_STABLE_FRAMES];
+  memcpy(s, v, n * sizeof(uint16_t));
+  std::sort(s, s + n);
+  return (n & 1) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2] + 1) / 2;
+}
+
+// True when every channel in the window spreads less than the tolerance
+// around its median.
+static bool converged(uint16_t window[3][PMS_STABLE_FRAMES]) {
+  for (int ch = 0; ch < 3; ch++) {
+    uint16_t lo = *std::min_element(window[ch], window[ch] + PMS_STABLE_FRAMES);
+    uint16_t hi = *std::max_element(window[ch], window[ch] + PMS_STABLE_FRAMES);
+    uint16_t med = median(window[ch], PMS_STABLE_FRAMES);
+    float tol = max((float)PMS_STABLE_ABS_TOL, med * PMS_STABLE_REL_TOL);
+    if (hi - lo > tol)
+      return false;
+  }
+  return true;
+}
+
+// Wakes the PMS7003 in active mode and streams frames until the last
+// PMS_STABLE_FRAMES agree (after PMS_WARMUP_MIN_MS) or PMS_WARMUP_MAX_MS
+// runs out. Reports the median of that window rather than one sample.
 bool readPMData(int &pm1_0, int &pm2_5, int &pm10) {
+  uint32_t start = millis();
   sendPMSCommand(CMD_WAKEUP);
-  delay(30000); // wait for PMS to stabilize
-  sendPMSCommand(CMD_PASSIVE);
-  delay(2000);
-  while (pmsSerial.available())
-    pmsSerial.read();
-  sendPMSCommand(CMD_REQUEST);
-  delay(1000);
-
-  if (pmsSerial.available() >= 32) {
-    uint8_t buf[32];
-    pmsSerial.readBytes(buf, 32);
-    if (buf[0] == 0x42 && buf[1] == 0x4D) {
-      pm1_0 = (buf[10] << 8) | buf[11];
-      pm2_5 = (buf[12] << 8) | buf[13];
-      pm10 = (buf[14] << 8) | buf[15];
-      Serial.printf("🌫️ PM1.0:%d PM2.5:%d PM10:%d\n", pm1_0, pm2_5, pm10);
-      statusPMS = true;
-      return true;
+  sendPMSCommand(CMD_ACTIVE);
+  pmsParser.reset();
+  uint32_t badFrames = pmsParser.checksumErrors + pmsParser.lengthErrors;
+
+  uint16_t window[3][PMS_STABLE_FRAMES];
+  uint16_t frames = 0;
+  bool stable = false;
+
+  while (millis() - start < PMS_WARMUP_MAX_MS) {
+    uint16_t pm[3];
+    if (!readActiveFrame(pm, start + PMS_WARMUP_MAX_MS))
+      break;
+    for (int ch = 0; ch < 3; ch++)
+      window[ch][frames % PMS_STABLE_FRAMES] = pm[ch];
+    frames++;
+
+    if (frames >= PMS_STABLE_FRAMES && millis() - start >= PMS_WARMUP_MIN_MS &&
+        converged(window)) {
+      stable = true;
+      break;
     }
   }
+
+  pmsStats.warmupMs = millis() - start;
+  pmsStats.frames = frames;
+  pmsStats.converged = stable;
+  pmsStats.badFrames =
+      pmsParser.checksumErrors + pmsParser.lengthErrors - badFrames;
+
+  if (frames >= PMS_STABLE_FRAMES) {
+    pm1_0 = median(window[0], PMS_STABLE_FRAMES);
+    pm2_5 = median(window[1], PMS_STABLE_FRAMES);
+    pm10 = median(window[2], PMS_STABLE_FRAMES);
+    Serial.printf("🌫️ PM1.0:%d PM2.5:%d PM10:%d (%u frames, %.1f s%s)\n",
+                  pm1_0, pm2_5, pm10, frames, pmsStats.warmupMs / 1000.0,
+                  stable ? "" : ", not converged");
+    setStatus(STATUS_PMS, true);
+    return true;
+  }
   Serial.println(F("❌ PM read failed"));
-  statusPMS = false;
+  setStatus(STATUS_PMS, false);
   return false;
-}
\ No newline at end of file
+}
+
+bool readPMSFrame(uint16_t pm[3], uint32_t deadline) {
+  return readActiveFrame(pm, deadline);
+}
+
+const PMSStats &getPMSStats() { return pmsStats; }
+
+const PMSFrame &getLastPMSFrame() { return pmsParser.frame(); }
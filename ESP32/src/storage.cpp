@@ -1,177 +1,528 @@
 #include "storage.h"
+#include "archive.h"
 #include "config.h"
 #include "globals.h"
+#include <Preferences.h>
 #include <SD.h>
 #include <SPI.h>
-#include "network.h"
+
+// Mounted once per wake; later calls only retry a failed mount
+static bool sdMounted = false;
 
 void initSD() {
+  if (sdMounted) {
+    setStatus(STATUS_SD, true);
+    return;
+  }
   // Try initializing SD card
-  if (SD.begin(SD_CS)) {
-    Serial.println(F("✅ SD card initialized"));
-    statusSD = true;
+  if (SD.begin(SD_CS, SPI, SD_SPI_HZ)) {
+    Serial.printf("✅ SD card initialized (%u MHz)\n",
+                  (unsigned)(SD_SPI_HZ / 1000000));
+    setStatus(STATUS_SD, true);
+    sdMounted = true;
   } else {
     Serial.println(F("⚠️ SD card init failed; will retry later"));
-    statusSD = false;
+    setStatus(STATUS_SD, false);
+  }
+}
+
+// ----- LOG WRITER -----
+// One handle on the log for the whole wake. Appends go into a buffer that
+// mirrors the log's last LOG_BLOCK_SIZE block, and the card only ever sees
+// whole, aligned blocks: FatFs writes them straight to the sector without
+// a read-modify-write. The unused end of the last block is zero-filled,
+// and with SD_PREALLOC_BLOCKS the file grows ahead in zeroed blocks, so
+// most flushes leave the file size (and its directory entry) untouched.
+// logRecordCount() ends the log at the first all-zero slot.
+struct LogWriter {
+  File file;
+  char name[32];
+  uint32_t count;      // records, buffered ones included
+  uint32_t blockStart; // file offset of block[]
+  uint32_t allocated;  // bytes the file holds on the card
+  bool dirty;          // block[] differs from the card
+  uint8_t block[LOG_BLOCK_SIZE];
+};
+
+static LogWriter writer;
+static const uint8_t ZERO_BLOCK[LOG_BLOCK_SIZE] = {};
+
+static bool slotEmpty(File &file, uint32_t index) {
+  uint8_t slot[LOG_RECORD_SIZE];
+  if (!file.seek(LOG_HEADER_SIZE + index * LOG_RECORD_SIZE) ||
+      file.read(slot, sizeof(slot)) != sizeof(slot))
+    return true;
+  for (uint8_t b : slot) {
+    if (b)
+      return false;
+  }
+  return true;
+}
+
+// A real record is never all zero (its CRC is not), so the used slots are
+// the ones before the first zero slot.
+uint32_t logRecordCount(File &file) {
+  if (file.size() < LOG_HEADER_SIZE + LOG_RECORD_SIZE)
+    return 0;
+  uint32_t slots = (file.size() - LOG_HEADER_SIZE) / LOG_RECORD_SIZE;
+  if (!slotEmpty(file, slots - 1))
+    return slots;
+  uint32_t lo = 0, hi = slots - 1; // hi is empty
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (slotEmpty(file, mid))
+      hi = mid;
+    else
+      lo = mid + 1;
   }
+  return lo;
 }
 
-void logToSD(const char *filename, float temp, float hum, int pm1, int pm25,
-             int pm10, float vin, float battery, struct tm *timeinfo) {
-  if (!SD.exists(filename)) {
-    File file = SD.open(filename, FILE_WRITE);
+// After a failed write the buffer no longer matches the card; the next
+// append reopens the log and starts from what actually got written
+static void dropLogWriter() {
+  writer.file.close();
+  writer.name[0] = '\0';
+}
+
+static bool writeBlock() {
+  File &file = writer.file;
+  if (!file.seek(writer.blockStart) ||
+      file.write(writer.block, LOG_BLOCK_SIZE) != LOG_BLOCK_SIZE)
+    return false;
+  uint32_t end = writer.blockStart + LOG_BLOCK_SIZE;
+  if (end > writer.allocated) {
+    // Grow ahead in one go; the zeros read as free slots
+    for (uint16_t i = 1; i < SD_PREALLOC_BLOCKS; i++) {
+      if (file.write(ZERO_BLOCK, LOG_BLOCK_SIZE) != LOG_BLOCK_SIZE)
+        break;
+      end += LOG_BLOCK_SIZE;
+    }
+    writer.allocated = end;
+  }
+  writer.dirty = false;
+  return true;
+}
+
+// The log compactLog() writes, before it takes the old one's place
+static void compactedPath(char *buf, size_t size, const char *logFile) {
+  snprintf(buf, size, "%s.new", logFile);
+}
+
+// A reset between compactLog() removing the old log and renaming the new
+// one leaves only the new one
+static void finishCompaction(const char *logFile) {
+  if (SD.exists(logFile))
+    return;
+  char path[40];
+  compactedPath(path, sizeof(path), logFile);
+  if (SD.exists(path) && SD.rename(path, logFile))
+    Serial.printf("⚠️ Finished compacting %s\n", logFile);
+}
+
+// A log whose header cannot be read is kept for inspection as <name>.bad
+// (replacing an older one) and a new log is started in its place. A file
+// too short to hold a header was cut off while being created and is
+// simply replaced.
+static bool setAsideLog(const char *filename, uint32_t size) {
+  if (size < LOG_HEADER_SIZE) {
+    Serial.printf("⚠️ %s is truncated, starting it again\n", filename);
+    return SD.remove(filename);
+  }
+  char bad[40];
+  snprintf(bad, sizeof(bad), "%s.bad", filename);
+  SD.remove(bad);
+  Serial.printf("⚠️ %s has no valid log header, moved to %s\n", filename,
+                bad);
+  return SD.rename(filename, bad);
+}
+
+// Opens a binary log, creating it with a fresh header when it does not
+// exist yet, and loads its last block. Anything after the last whole
+// record (a record torn by a brownout) is cleared and overwritten.
+static bool openLogWriter(const char *filename, uint32_t created) {
+  if (writer.file && strcmp(writer.name, filename) == 0)
+    return true;
+  closeLog();
+
+  finishCompaction(filename);
+  memset(writer.block, 0, sizeof(writer.block));
+  File file = SD.open(filename, "r+");
+  if (file) {
+    LogHeader hdr;
+    if (file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+        !logHeaderValid(hdr)) {
+      uint32_t size = file.size();
+      file.close();
+      file = File();
+      if (!setAsideLog(filename, size)) {
+        Serial.printf("❌ Cannot replace %s\n", filename);
+        return false;
+      }
+    } else {
+      writer.count = logRecordCount(file);
+      uint32_t end = LOG_HEADER_SIZE + writer.count * LOG_RECORD_SIZE;
+      writer.blockStart = end - end % LOG_BLOCK_SIZE;
+      writer.allocated = file.size();
+      file.seek(writer.blockStart);
+      file.read(writer.block, end - writer.blockStart);
+      writer.dirty = false;
+    }
+  }
+
+  if (!file) {
+    file = SD.open(filename, FILE_WRITE);
     if (!file) {
       Serial.printf("❌ Failed to create file: %s\n", filename);
-      statusSD = false;
-      return;
+      return false;
     }
-    file.println("timestamp,temp,hum,pm1,pm2.5,pm10,battery,vin");
-    file.close();
+    LogHeader hdr;
+    initLogHeader(hdr, created);
+    memcpy(writer.block, &hdr, sizeof(hdr));
+    writer.count = 0;
+    writer.blockStart = 0;
+    writer.allocated = 0;
+    writer.file = file;
+    // The header goes out now: a reset before the first flush must not
+    // leave an empty file behind
+    if (!writeBlock()) {
+      Serial.printf("❌ Failed to write the header of %s\n", filename);
+      file.close();
+      writer.file = File();
+      return false;
+    }
+    writer.file.flush();
     Serial.printf("✅ Created %s with header.\n", filename);
-    statusSD = true;
   }
 
-  File file = SD.open(filename, FILE_APPEND);
-  if (!file) {
-    Serial.printf("❌ Failed to open %s for append\n", filename);
-    statusSD = false;
-    return;
+  writer.file = file;
+  strncpy(writer.name, filename, sizeof(writer.name) - 1);
+  writer.name[sizeof(writer.name) - 1] = '\0';
+  return true;
+}
+
+bool appendRecords(const char *filename, const LogRecord *recs, size_t n) {
+  if (!openLogWriter(filename, n ? recs[0].ts : 0)) {
+    setStatus(STATUS_SD, false);
+    return false;
   }
 
-  if (timeinfo) {
-    char timeStr[30];
-    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
-    file.print(timeStr);
-    Serial.printf("Logging to %s with timestamp: %s\n", filename, timeStr);
-  } else {
-    uint32_t ms = millis() / 1000;
-    file.print(ms);
-    Serial.printf("Logging to %s with millis(): %u\n", filename, ms);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t offset = LOG_HEADER_SIZE + writer.count * LOG_RECORD_SIZE;
+    if (offset - writer.blockStart == LOG_BLOCK_SIZE) {
+      // records never straddle blocks, so a full block goes out whole
+      if (writer.dirty && !writeBlock()) {
+        Serial.printf("❌ Write to %s failed\n", filename);
+        dropLogWriter();
+        setStatus(STATUS_SD, false);
+        return false;
+      }
+      writer.blockStart += LOG_BLOCK_SIZE;
+      memset(writer.block, 0, sizeof(writer.block));
+      offset = writer.blockStart;
+    }
+    memcpy(writer.block + (offset - writer.blockStart), recs + i,
+           LOG_RECORD_SIZE);
+    writer.count++;
+    writer.dirty = true;
   }
+  return true;
+}
 
-  file.print(",");
-  file.print(temp);
-  file.print(",");
-  file.print(hum);
-  file.print(",");
-  file.print(pm1);
-  file.print(",");
-  file.print(pm25);
-  file.print(",");
-  file.println(pm10);
-  file.print(",");
-  file.println(battery);
-  file.print(",");
-  file.println(vin);
+bool lastLogRecord(const char *filename, LogRecord &rec) {
+  if (!writer.file || strcmp(writer.name, filename) != 0) {
+    finishCompaction(filename);
+    if (!SD.exists(filename))
+      return false; // not created here, appendRecords() knows its date
+  }
+  if (!openLogWriter(filename, 0) || writer.count == 0)
+    return false;
+  uint32_t offset = LOG_HEADER_SIZE + (writer.count - 1) * LOG_RECORD_SIZE;
+  if (offset >= writer.blockStart) {
+    memcpy(&rec, writer.block + (offset - writer.blockStart), sizeof(rec));
+    return true;
+  }
+  return writer.file.seek(offset) &&
+         writer.file.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+}
 
-  file.close();
-  Serial.println(F("💾 Data logged to SD successfully."));
-  statusSD = true;
+bool flushLog() {
+  if (!writer.file)
+    return true;
+  if (writer.dirty && !writeBlock()) {
+    Serial.printf("❌ Short write to %s\n", writer.name);
+    dropLogWriter();
+    setStatus(STATUS_SD, false);
+    return false;
+  }
+  writer.file.flush();
+  setStatus(STATUS_SD, true);
+  return true;
 }
 
+void closeLog() {
+  if (!writer.file)
+    return;
+  flushLog();
+  dropLogWriter();
+}
 
+void closeStorage() {
+  closeLog();
+  if (sdMounted) {
+    SD.end();
+    sdMounted = false;
+  }
+}
 
-// 2. Function to process the backlog
-void logToBacklog(const char *filename, float temp, float hum, int pm1,
-                  int pm25, int pm10, float v1, float v2, struct tm *timeinfo) {
-  File file = SD.open(filename, FILE_APPEND);
-  if (!file)
-    return;
+void logToSD(const char *filename, const LogRecord &rec) {
+  if (appendRecords(filename, &rec, 1) && flushLog()) {
+    Serial.printf("💾 Record logged to %s (ts=%u).\n", filename,
+                  (unsigned)rec.ts);
+  }
+}
 
-  // Format: timestamp,temp,hum,pm1,pm25,pm10,v1,v2
-  char timeStr[30];
-  if (timeinfo)
-    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
+bool readRecord(File &file, uint32_t index, LogRecord &rec) {
+  if (!file.seek(LOG_HEADER_SIZE + index * LOG_RECORD_SIZE))
+    return false;
+  if (file.read((uint8_t *)&rec, sizeof(rec)) != sizeof(rec))
+    return false;
+  return recordValid(rec);
+}
+
+// ----- LONG-TERM ARCHIVE -----
+// Records are compressed into the archive (see archive.h) one full block
+// at a time. NVS keeps the index of the first log record not archived yet,
+// tagged with the log's logId like the upload cursors; records that do not
+// fill a block yet wait in the master log for a later wake.
+uint32_t archiveCursor(const LogHeader &hdr) {
+  Preferences prefs;
+  prefs.begin(CURSOR_NVS_NAMESPACE, true);
+  uint32_t storedId = prefs.getUInt("arc_logId", 0);
+  uint32_t cursor = prefs.getUInt("arc_cursor", 0);
+  prefs.end();
+  return logCursor(hdr, storedId, cursor) ? cursor : 0;
+}
+
+static void saveArchiveCursor(uint32_t logId, uint32_t cursor) {
+  Preferences prefs;
+  prefs.begin(CURSOR_NVS_NAMESPACE, false);
+  prefs.putUInt("arc_logId", logId);
+  prefs.putUInt("arc_cursor", cursor);
+  prefs.end();
+}
+
+uint32_t archiveMonth(uint32_t ts) {
+  if (!ts)
+    return 0;
+  time_t local = (time_t)ts + GMT_OFFSET_SEC + DAYLIGHT_OFFSET_SEC;
+  struct tm t;
+  gmtime_r(&local, &t);
+  return (uint32_t)(t.tm_year + 1900) * 12 + t.tm_mon;
+}
+
+void archivePartitionPath(char *buf, size_t size, const char *archiveDir,
+                          uint32_t month, const char *ext) {
+  if (month)
+    snprintf(buf, size, "%s/%04u-%02u.%s", archiveDir, (unsigned)(month / 12),
+             (unsigned)(month % 12 + 1), ext);
   else
-    strcpy(timeStr, "0");
+    snprintf(buf, size, "%s/undated.%s", archiveDir, ext);
+}
 
-  file.printf("%s,%.2f,%.2f,%d,%d,%d,%.2f,%.2f\n", timeStr, temp, hum, pm1,
-              pm25, pm10, v1, v2);
-  file.close();
-  Serial.println(F("⚠️ Upload failed/offline. Data saved to backlog."));
+static File openForUpdate(const char *path) {
+  File file = SD.open(path, "r+");
+  if (!file)
+    file = SD.open(path, FILE_WRITE);
+  return file;
 }
 
-void processBacklog(const char *backlogFile) {
-  if (!SD.exists(backlogFile))
-    return;
+// The open month of the archive: its blocks and its index
+struct ArchivePartition {
+  uint32_t key;
+  File blocks, index;
+};
 
-  Serial.println(F("🔄 Processing offline backlog..."));
+static void closePartition(ArchivePartition &part) {
+  if (part.blocks)
+    part.blocks.close();
+  if (part.index)
+    part.index.close();
+}
 
-  File file = SD.open(backlogFile, FILE_READ);
-  File tempFile = SD.open("/temp_backlog.csv", FILE_WRITE);
+static bool openPartition(ArchivePartition &part, uint32_t key,
+                          const char *archiveDir) {
+  if (part.blocks && part.key == key)
+    return true;
+  closePartition(part);
+  if (!SD.exists(archiveDir))
+    SD.mkdir(archiveDir);
+  char path[32];
+  archivePartitionPath(path, sizeof(path), archiveDir, key, "bin");
+  part.blocks = openForUpdate(path);
+  archivePartitionPath(path, sizeof(path), archiveDir, key, "idx");
+  part.index = openForUpdate(path);
+  part.key = key;
+  if (part.blocks && part.index)
+    return true;
+  Serial.printf("❌ Failed to open %s\n", path);
+  closePartition(part);
+  return false;
+}
+
+// Appends after the partition's last whole block, so a block torn by a
+// brownout is overwritten, and puts its index entry at the same position
+static bool writePartition(ArchivePartition &part, const ArchiveEncoder &enc) {
+  uint32_t blockNo = part.blocks.size() / ARCHIVE_BLOCK_SIZE;
+  ArchiveIndexEntry entry;
+  entry.tsMin = enc.stats.tsMin;
+  entry.tsMax = enc.stats.tsMax;
+  return part.blocks.seek(blockNo * ARCHIVE_BLOCK_SIZE) &&
+         part.blocks.write(enc.block, ARCHIVE_BLOCK_SIZE) ==
+             ARCHIVE_BLOCK_SIZE &&
+         part.index.seek(blockNo * sizeof(entry)) &&
+         part.index.write((const uint8_t *)&entry, sizeof(entry)) ==
+             sizeof(entry);
+}
 
-  if (!file || !tempFile) {
-    Serial.println(F("❌ Error opening backlog files"));
+void archiveLog(const char *logFile, const char *archiveDir) {
+  File log = SD.open(logFile, FILE_READ);
+  if (!log)
+    return;
+  LogHeader hdr;
+  if (log.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+      !logHeaderValid(hdr)) {
+    log.close();
     return;
   }
 
-  int processedCount = 0;
-  int maxUploadsPerCycle = 5;
+  uint32_t total = logRecordCount(log);
+  uint32_t cursor = archiveCursor(hdr);
+  if (cursor > total)
+    cursor = 0; // log is shorter than the cursor, so it is not the same file
 
-  while (file.available()) {
-    String line = file.readStringUntil('\n');
-    line.trim();
-    if (line.length() == 0)
-      continue;
+  static ArchiveEncoder enc; // 512-byte block, kept off the stack
+  ArchivePartition part;
+  uint8_t blocks = 0;
+  uint32_t archived = 0;
 
-    if (processedCount >= maxUploadsPerCycle) {
-      tempFile.println(line);
-      continue;
+  while (blocks < ARCHIVE_MAX_BLOCKS) {
+    archiveBegin(enc);
+    uint32_t next = cursor;
+    uint32_t key = 0; // month of the block's first dated record
+    bool full = false;
+    LogRecord rec;
+    for (; next < total; next++) {
+      if (!readRecord(log, next, rec))
+        continue; // failed its CRC, not worth keeping
+      // A new month closes the block early, so no block spans two files
+      uint32_t recKey = archiveMonth(rec.ts);
+      if (recKey && key && recKey != key) {
+        full = true;
+        break;
+      }
+      if (!archiveAdd(enc, rec)) {
+        full = true;
+        break;
+      }
+      if (!key)
+        key = recKey;
     }
+    if (!full)
+      break;
 
-    // --- PARSE DATA ---
-    char buffer[128];
-    line.toCharArray(buffer, sizeof(buffer));
-
-    // 1. Parse Timestamp String (e.g., "2024-11-24 10:00:00")
-    char *token = strtok(buffer, ",");
-    String tStamp = String(token);
-
-    // 2. Parse Sensor Values
-    float t = atof(strtok(NULL, ","));
-    float h = atof(strtok(NULL, ","));
-    int p1 = atoi(strtok(NULL, ","));
-    int p2 = atoi(strtok(NULL, ","));
-    int p10 = atoi(strtok(NULL, ","));
-    float v1 = atof(strtok(NULL, ","));
-    float v2 = atof(strtok(NULL, ","));
-
-    // 3. Reconstruct 'struct tm' from Timestamp String
-    struct tm historicTime = {0};
-    int year, month, day, hour, minute, second;
-
-    // sscanf parses the string into integers
-    if (sscanf(tStamp.c_str(), "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour,
-               &minute, &second) == 6) {
-      historicTime.tm_year = year - 1900; // tm_year is years since 1900
-      historicTime.tm_mon = month - 1;    // tm_mon is 0-11
-      historicTime.tm_mday = day;
-      historicTime.tm_hour = hour;
-      historicTime.tm_min = minute;
-      historicTime.tm_sec = second;
-      historicTime.tm_isdst = -1; // Let mktime guess DST
+    if (!openPartition(part, key, archiveDir))
+      break;
+    archiveFinish(enc);
+    if (!writePartition(part, enc)) {
+      Serial.printf("❌ Short write to the %s archive\n", archiveDir);
+      break;
     }
+    archived += next - cursor;
+    cursor = next;
+    saveArchiveCursor(hdr.logId, cursor);
+    blocks++;
+  }
 
-    // --- ATTEMPT UPLOAD ---
-    // Pass the historicTime address
-    statusRender = false;
-    sendToRenderBackend(t, h, p1, p2, p10, v1, v2, &historicTime);
+  closePartition(part);
+  log.close();
+  if (blocks) {
+    Serial.printf("🗜️ Archived %u record(s) into %u block(s) under %s\n",
+                  (unsigned)archived, blocks, archiveDir);
+  }
+}
 
-    if (statusRender == true) {
-      Serial.printf("✅ Backlog item from %s uploaded!\n", tStamp.c_str());
-      processedCount++;
-      // Data successfully sent, so we DO NOT write it to tempFile (effectively
-      // deleting it)
-    } else {
-      Serial.println(F("❌ Backlog upload failed, keeping in file."));
-      tempFile.println(line); // Write back to temp file to try again later
-    }
+// ----- COMPACTION -----
+// The records from `drop` on are copied into <log>.new in whole blocks,
+// under a header that names the old log, and the old log is replaced by
+// it. The archive cursor is saved again against the new log here, the
+// upload cursors by the caller; one a reset leaves behind still finds its
+// record through logCursor().
+bool compactLog(const char *logFile, uint32_t drop, LogHeader &hdr) {
+  closeLog();
+  File log = SD.open(logFile, FILE_READ);
+  if (!log)
+    return false;
+  LogHeader old;
+  if (log.read((uint8_t *)&old, sizeof(old)) != sizeof(old) ||
+      !logHeaderValid(old)) {
+    log.close();
+    return false;
+  }
+  uint32_t total = logRecordCount(log);
+  if (drop == 0 || drop > total) {
+    log.close();
+    return false;
   }
 
-  file.close();
-  tempFile.close();
+  char path[40];
+  compactedPath(path, sizeof(path), logFile);
+  SD.remove(path); // left by a compaction cut short
+  File out = SD.open(path, FILE_WRITE);
+  if (!out) {
+    log.close();
+    Serial.printf("❌ Failed to create file: %s\n", path);
+    return false;
+  }
+
+  initLogHeader(hdr, old.created);
+  hdr.prevLogId = old.logId;
+  hdr.base = drop;
+  hdr.crc = crc16((const uint8_t *)&hdr, sizeof(hdr) - sizeof(hdr.crc));
+
+  static uint8_t block[LOG_BLOCK_SIZE];
+  memcpy(block, &hdr, sizeof(hdr));
+  size_t used = sizeof(hdr);
+  uint32_t left = (total - drop) * LOG_RECORD_SIZE;
+  bool ok = log.seek(LOG_HEADER_SIZE + drop * LOG_RECORD_SIZE);
+  while (ok) {
+    size_t n = min(left, (uint32_t)(sizeof(block) - used));
+    ok = log.read(block + used, n) == n;
+    used += n;
+    left -= n;
+    if (ok && (used == sizeof(block) || left == 0)) {
+      memset(block + used, 0, sizeof(block) - used);
+      ok = out.write(block, sizeof(block)) == sizeof(block);
+      used = 0;
+    }
+    if (left == 0)
+      break;
+  }
+  out.flush();
+  out.close();
+  log.close();
 
-  // Swap files
-  SD.remove(backlogFile);
-  SD.rename("/temp_backlog.csv", backlogFile);
-}
\ No newline at end of file
+  if (!ok) {
+    Serial.printf("❌ Short write to %s\n", path);
+    SD.remove(path);
+    return false;
+  }
+  if (!SD.remove(logFile) || !SD.rename(path, logFile)) {
+    Serial.printf("❌ Could not replace %s with %s\n", logFile, path);
+    return false;
+  }
+  saveArchiveCursor(hdr.logId, archiveCursor(hdr));
+  Serial.printf("🧹 Dropped %u record(s) from %s, %u kept\n", (unsigned)drop,
+                logFile, (unsigned)(total - drop));
+  return true;
+}
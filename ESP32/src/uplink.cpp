@@ -0,0 +1,121 @@
+#include "uplink.h"
+#include "config.h"
+#include "record.h"
+
+// Kept in RTC memory so the policy sees previous wakes
+struct UplinkState {
+  uint32_t cyclesSinceUpload;
+  uint32_t cyclesSinceAttempt;
+  int16_t lastPm25; // -1 until the first good reading
+  uint16_t reportedFaults; // FAULT_MASK bits down in the last upload
+  uint8_t failedAttempts;  // in a row; 0 once an upload gets through
+  bool valid;
+};
+
+static RTC_DATA_ATTR UplinkState uplinkState = {0, 0, -1, 0, 0, false};
+
+// After a failed attempt the radio stays off for UPLINK_EVERY_N_CYCLES
+// wakes, doubling with each further failure up to UPLINK_BACKOFF_MAX_CYCLES,
+// whatever asks for it: an AP or backend that is down for days would
+// otherwise cost a connect timeout every wake.
+static bool backingOff() {
+  if (!uplinkState.failedAttempts)
+    return false;
+  uint8_t doublings = min<uint8_t>(uplinkState.failedAttempts - 1, 8);
+  uint32_t wait = min<uint32_t>(UPLINK_EVERY_N_CYCLES << doublings,
+                                UPLINK_BACKOFF_MAX_CYCLES);
+  return uplinkState.cyclesSinceAttempt + 1 < wait;
+}
+
+// Faults worth waking the radio for. WiFi/NTP/ThingSpeak/Render are
+// expected to be down on offline cycles, so they don't count. Only a new
+// fault does: one the backend has already been sent waits for the
+// schedule like any other reading, so a dead sensor does not keep the
+// radio on every wake.
+static const uint16_t FAULT_MASK = STATUS_AHT | STATUS_RTC | STATUS_PMS | STATUS_SD;
+
+static bool newFault(uint16_t status) {
+  return (~status & FAULT_MASK & ~uplinkState.reportedFaults) != 0;
+}
+
+UplinkReason shouldConnect(int pm25, uint16_t status, uint32_t pending) {
+  if (!uplinkState.valid) {
+    return UPLINK_SCHEDULED; // cold boot: report in straight away
+  }
+  if (backingOff()) {
+    return UPLINK_NONE;
+  }
+  if (newFault(status)) {
+    return UPLINK_FAULT;
+  }
+  // Crossing the alert level, not staying above it: winter PM can sit over
+  // it for weeks, and those readings go out on the schedule
+  int last = uplinkState.lastPm25;
+  if ((pm25 >= UPLINK_PM25_ALERT && last < UPLINK_PM25_ALERT) ||
+      (pm25 >= 0 && last >= 0 && pm25 - last >= UPLINK_PM25_JUMP)) {
+    return UPLINK_PM_ALERT;
+  }
+  if (pending >= UPLINK_PENDING_THRESHOLD) {
+    return UPLINK_BACKLOG;
+  }
+  if (uplinkState.cyclesSinceUpload + 1 >= UPLINK_EVERY_N_CYCLES) {
+    return UPLINK_SCHEDULED;
+  }
+  return UPLINK_NONE;
+}
+
+UplinkReason uplinkDueBeforeReading(uint32_t pending, bool sdOk) {
+  if (!uplinkState.valid) {
+    return UPLINK_SCHEDULED;
+  }
+  if (backingOff()) {
+    return UPLINK_NONE;
+  }
+  if (uplinkState.cyclesSinceUpload + 1 >= UPLINK_EVERY_N_CYCLES) {
+    return UPLINK_SCHEDULED;
+  }
+  if (!sdOk && newFault(FAULT_MASK & ~STATUS_SD)) {
+    return UPLINK_FAULT;
+  }
+  if (pending >= UPLINK_PENDING_THRESHOLD) {
+    return UPLINK_BACKLOG;
+  }
+  return UPLINK_NONE;
+}
+
+void recordUplinkResult(bool attempted, bool uploaded, int pm25,
+                        uint16_t status) {
+  if (uploaded) {
+    uplinkState.cyclesSinceUpload = 0;
+    uplinkState.reportedFaults = ~status & FAULT_MASK;
+    uplinkState.failedAttempts = 0;
+  } else {
+    uplinkState.cyclesSinceUpload++;
+  }
+  if (attempted) {
+    uplinkState.cyclesSinceAttempt = 0;
+    if (!uploaded && uplinkState.failedAttempts < 255)
+      uplinkState.failedAttempts++;
+  } else {
+    uplinkState.cyclesSinceAttempt++;
+  }
+  if (pm25 >= 0) {
+    uplinkState.lastPm25 = pm25;
+  }
+  uplinkState.valid = true;
+}
+
+const char *uplinkReasonName(UplinkReason reason) {
+  switch (reason) {
+  case UPLINK_SCHEDULED:
+    return "scheduled";
+  case UPLINK_BACKLOG:
+    return "backlog";
+  case UPLINK_PM_ALERT:
+    return "pm-alert";
+  case UPLINK_FAULT:
+    return "fault";
+  default:
+    return "none";
+  }
+}
@@ -0,0 +1,254 @@
+#include "uploader.h"
+#include "config.h"
+#include "network.h"
+#include "record.h"
+#include "storage.h"
+#include <Preferences.h>
+#include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+
+struct UploadSink {
+  const char *name;
+  const char *logIdKey;  // NVS keys in CURSOR_NVS_NAMESPACE
+  const char *cursorKey;
+  uint32_t maxRecords;   // per request
+  uint32_t minGapMs;     // between requests
+  uint32_t backfill;     // records sent when the log is new to the sink
+  bool (*enabled)();
+  bool (*sendBatch)(File &log, uint32_t first, uint32_t count, bool withMeta,
+                    size_t &bytesSent);
+  void (*finish)();
+  uint32_t stackSize;
+  StackType_t *stack;
+};
+
+static bool always() { return true; }
+
+static StackType_t renderStack[RENDER_SINK_STACK];
+static StackType_t thingSpeakStack[THINGSPEAK_SINK_STACK];
+
+// Render keeps the key names from before there was more than one sink, so
+// an updated device carries on where it left off.
+static const UploadSink SINKS[] = {
+    {"Render", "logId", "cursor", BATCH_MAX_RECORDS, 0, UINT32_MAX, always,
+     sendBatchToRenderBackend, closeRenderConnection, RENDER_SINK_STACK,
+     renderStack},
+    {"ThingSpeak", "ts_logId", "ts_cursor", THINGSPEAK_BULK_MAX_RECORDS,
+     THINGSPEAK_BULK_GAP_MS, THINGSPEAK_BACKFILL, thingSpeakBulkEnabled,
+     sendBatchToThingSpeak, closeThingSpeakConnection, THINGSPEAK_SINK_STACK,
+     thingSpeakStack},
+};
+static const size_t SINK_COUNT = sizeof(SINKS) / sizeof(SINKS[0]);
+
+// This wake only
+struct SinkTask {
+  const UploadSink *sink;
+  const char *logFile;
+  bool withMeta; // the last batch of this call carries the cycle meta
+  StaticTask_t tcb;
+  TaskHandle_t handle;
+  uint32_t lastRequestMs; // 0 until the first request of this wake
+};
+
+static SinkTask sinkTasks[SINK_COUNT];
+static EventGroupHandle_t sinkEvents = nullptr;
+static StaticEventGroup_t sinkEventsBuffer;
+
+// ----- CURSORS -----
+// Index of the first record the sink has not had acknowledged, tagged with
+// the logId of the file it refers to (or of the log it was compacted
+// from, see logCursor()). A log the sink has not seen before (new card,
+// recreated file, new sink) starts sink.backfill records from its end.
+static uint32_t loadCursor(const UploadSink &sink, const LogHeader &hdr,
+                           uint32_t total) {
+  Preferences prefs;
+  prefs.begin(CURSOR_NVS_NAMESPACE, true);
+  uint32_t storedId = prefs.getUInt(sink.logIdKey, 0);
+  uint32_t cursor = prefs.getUInt(sink.cursorKey, 0);
+  prefs.end();
+  bool known = logCursor(hdr, storedId, cursor);
+
+  if (!known)
+    cursor = total > sink.backfill ? total - sink.backfill : 0;
+  // a log shorter than the cursor is not the same file
+  return cursor <= total ? cursor : 0;
+}
+
+static void saveCursor(const UploadSink &sink, uint32_t logId,
+                       uint32_t cursor) {
+  Preferences prefs;
+  prefs.begin(CURSOR_NVS_NAMESPACE, false);
+  prefs.putUInt(sink.logIdKey, logId);
+  prefs.putUInt(sink.cursorKey, cursor);
+  prefs.end();
+}
+
+static File openLog(const char *logFile, LogHeader &hdr) {
+  File file = SD.open(logFile, FILE_READ);
+  if (!file)
+    return file;
+  if (file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+      !logHeaderValid(hdr)) {
+    file.close();
+    return File();
+  }
+  return file;
+}
+
+// ----- SINK TASK -----
+// Sends batches until the sink has caught up or this call's byte/time
+// budget is spent; the cursor is committed after every accepted batch.
+static void drainSink(SinkTask &task) {
+  const UploadSink &sink = *task.sink;
+  LogHeader hdr;
+  File file = openLog(task.logFile, hdr);
+  if (!file) {
+    Serial.printf("❌ %s: cannot read %s\n", sink.name, task.logFile);
+    return;
+  }
+
+  uint32_t total = logRecordCount(file);
+  uint32_t cursor = loadCursor(sink, hdr, total);
+  if (cursor == total) {
+    file.close();
+    return;
+  }
+  Serial.printf("🔄 %s: replaying %u record(s) from #%u...\n", sink.name,
+                (unsigned)(total - cursor), (unsigned)cursor);
+
+  uint32_t sent = 0;
+  size_t bytesUsed = 0;
+  uint32_t start = millis();
+
+  while (cursor < total && bytesUsed < BACKLOG_BYTE_BUDGET) {
+    uint32_t wait = 0;
+    if (task.lastRequestMs && millis() - task.lastRequestMs < sink.minGapMs)
+      wait = sink.minGapMs - (millis() - task.lastRequestMs);
+    // The gap may be left over from an earlier dispatch this wake. Keeping
+    // the radio up through it costs more than sending the records with the
+    // next wake, when the gap has long passed.
+    if (wait > SINK_MAX_GAP_WAIT_MS ||
+        millis() - start + wait >= BACKLOG_TIME_BUDGET_MS)
+      break;
+    if (wait)
+      delay(wait);
+
+    uint32_t count = min(total - cursor, sink.maxRecords);
+    size_t bytes = 0;
+    bool meta = task.withMeta && cursor + count == total;
+    uint32_t previousMs = task.lastRequestMs;
+    task.lastRequestMs = millis();
+    if (!sink.sendBatch(file, cursor, count, meta, bytes)) {
+      Serial.printf("❌ %s: upload failed, will resume here next cycle.\n",
+                    sink.name);
+      break;
+    }
+    if (bytes == 0) // skipped without a request
+      task.lastRequestMs = previousMs;
+
+    sent += count;
+    bytesUsed += bytes;
+    cursor += count;
+    saveCursor(sink, hdr.logId, cursor);
+  }
+
+  file.close();
+  Serial.printf("📤 %s: %u record(s) uploaded in %u ms, %u still pending.\n",
+                sink.name, (unsigned)sent, (unsigned)(millis() - start),
+                (unsigned)(total - cursor));
+}
+
+static void sinkTask(void *arg) {
+  SinkTask &task = *(SinkTask *)arg;
+  drainSink(task);
+  xEventGroupSetBits(sinkEvents, BIT0 << (&task - sinkTasks));
+  // Deleted by dispatchUploads(), which lets the same TCB and stack be
+  // used again in this wake without waiting for the idle task.
+  vTaskSuspend(nullptr);
+}
+
+// ----- DISPATCH -----
+
+void dispatchUploads(const char *logFile, bool withMeta) {
+  if (!sinkEvents)
+    sinkEvents = xEventGroupCreateStatic(&sinkEventsBuffer);
+
+  EventBits_t running = 0;
+  for (size_t i = 0; i < SINK_COUNT; i++) {
+    const UploadSink &sink = SINKS[i];
+    if (!sink.enabled())
+      continue;
+    SinkTask &task = sinkTasks[i];
+    task.sink = &sink;
+    task.logFile = logFile;
+    task.withMeta = withMeta;
+    xEventGroupClearBits(sinkEvents, BIT0 << i);
+    task.handle = xTaskCreateStaticPinnedToCore(
+        sinkTask, sink.name, sink.stackSize, &task, 1, sink.stack, &task.tcb,
+        0);
+    running |= BIT0 << i;
+  }
+
+  if (running)
+    xEventGroupWaitBits(sinkEvents, running, pdTRUE, pdTRUE, portMAX_DELAY);
+
+  for (size_t i = 0; i < SINK_COUNT; i++) {
+    if (running & (BIT0 << i)) {
+      vTaskDelete(sinkTasks[i].handle);
+      sinkTasks[i].handle = nullptr;
+    }
+  }
+}
+
+void finishUploads() {
+  for (size_t i = 0; i < SINK_COUNT; i++) {
+    if (SINKS[i].enabled() && SINKS[i].finish)
+      SINKS[i].finish();
+  }
+}
+
+uint32_t pendingUploads(const char *logFile) {
+  LogHeader hdr;
+  File file = openLog(logFile, hdr);
+  if (!file)
+    return 0;
+
+  uint32_t total = logRecordCount(file);
+  uint32_t pending = 0;
+  for (size_t i = 0; i < SINK_COUNT; i++) {
+    if (!SINKS[i].enabled())
+      continue;
+    uint32_t behind = total - loadCursor(SINKS[i], hdr, total);
+    pending = max(pending, behind);
+  }
+  file.close();
+  return pending;
+}
+
+void pruneLog(const char *logFile) {
+  LogHeader hdr;
+  File file = openLog(logFile, hdr);
+  if (!file)
+    return;
+  uint32_t total = logRecordCount(file);
+  uint32_t done = min(archiveCursor(hdr), total);
+  uint32_t cursors[SINK_COUNT];
+  for (size_t i = 0; i < SINK_COUNT; i++) {
+    cursors[i] = loadCursor(SINKS[i], hdr, total);
+    if (SINKS[i].enabled())
+      done = min(done, cursors[i]);
+  }
+  file.close();
+  if (done < LOG_COMPACT_RECORDS)
+    return;
+
+  LogHeader compacted;
+  if (!compactLog(logFile, done, compacted))
+    return;
+  for (size_t i = 0; i < SINK_COUNT; i++) {
+    if (SINKS[i].enabled())
+      saveCursor(SINKS[i], compacted.logId, cursors[i] - done);
+  }
+}
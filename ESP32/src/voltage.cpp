@@ -0,0 +1,154 @@
+#include "voltage.h"
+#include "config.h"
+#include <Preferences.h>
+#include <algorithm>
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+// GPIO36 and GPIO35 on ADC1, which keeps working while WiFi is up
+static const adc1_channel_t CHANNELS[VOLT_COUNT] = {ADC1_CHANNEL_0,
+                                                    ADC1_CHANNEL_7};
+static const char *const GAIN_KEYS[VOLT_COUNT] = {"gain_vin", "gain_bat"};
+static const char *const CHANNEL_NAMES[VOLT_COUNT] = {"Vin", "Battery"};
+
+static esp_adc_cal_characteristics_t adcChars;
+static float gains[VOLT_COUNT] = {1.0f, 1.0f};
+static VoltageStats voltageStats;
+
+void initVoltage() {
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  for (int c = 0; c < VOLT_COUNT; c++)
+    adc1_config_channel_atten(CHANNELS[c], ADC_ATTEN_DB_11);
+
+  esp_adc_cal_value_t source = esp_adc_cal_characterize(
+      ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, ADC_DEFAULT_VREF_MV,
+      &adcChars);
+
+  Preferences prefs;
+  prefs.begin(ADC_NVS_NAMESPACE, true);
+  for (int c = 0; c < VOLT_COUNT; c++) {
+    float g = prefs.getFloat(GAIN_KEYS[c], 1.0f);
+    gains[c] = isnan(g) || g <= 0 ? 1.0f : g;
+  }
+  prefs.end();
+
+  Serial.printf("✅ ADC characterised from %s, gain Vin %.4f, Bat %.4f\n",
+                source == ESP_ADC_CAL_VAL_EFUSE_TP     ? "eFuse two-point"
+                : source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref"
+                                                       : "default Vref",
+                gains[VOLT_VIN], gains[VOLT_BATTERY]);
+}
+
+// Mean of the samples within ADC_OUTLIER_MADS median absolute deviations
+// of the median. Sorts samples in place.
+static float robustMean(uint16_t *samples, uint16_t n, uint16_t &rejected) {
+  std::sort(samples, samples + n);
+  uint16_t median = samples[n / 2];
+
+  uint16_t dev[ADC_SAMPLES];
+  for (uint16_t i = 0; i < n; i++)
+    dev[i] = abs((int)samples[i] - median);
+  std::nth_element(dev, dev + n / 2, dev + n);
+  // at least a couple of counts, or a quiet channel would reject its noise
+  float limit = max(2.0f, ADC_OUTLIER_MADS * dev[n / 2]);
+
+  uint32_t sum = 0;
+  uint16_t kept = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    if (fabsf((float)samples[i] - median) <= limit) {
+      sum += samples[i];
+      kept++;
+    }
+  }
+  rejected = n - kept;
+  return kept ? (float)sum / kept : median;
+}
+
+// Volts at each divider input before the per-board gain
+static void measure(float *volts) {
+  uint16_t samples[VOLT_COUNT][ADC_SAMPLES];
+  uint32_t t0 = micros();
+  for (uint16_t i = 0; i < ADC_SAMPLES; i++) {
+    for (int c = 0; c < VOLT_COUNT; c++)
+      samples[c][i] = adc1_get_raw(CHANNELS[c]);
+  }
+  voltageStats.us = micros() - t0;
+  voltageStats.samples = ADC_SAMPLES;
+
+  for (int c = 0; c < VOLT_COUNT; c++) {
+    float raw = robustMean(samples[c], ADC_SAMPLES, voltageStats.rejected[c]);
+    // esp_adc_cal is piecewise linear, so converting the mean is as good
+    // as averaging converted samples; interpolate between whole counts
+    uint32_t lo = esp_adc_cal_raw_to_voltage((uint32_t)raw, &adcChars);
+    uint32_t hi = esp_adc_cal_raw_to_voltage((uint32_t)raw + 1, &adcChars);
+    float mv = lo + (hi - lo) * (raw - (uint32_t)raw);
+    volts[c] = mv / 1000.0f / VOLTAGE_DIVIDER_RATIO;
+  }
+}
+
+void readVoltages(float &vin, float &battery) {
+  float volts[VOLT_COUNT];
+  measure(volts);
+  vin = volts[VOLT_VIN] * gains[VOLT_VIN];
+  battery = volts[VOLT_BATTERY] * gains[VOLT_BATTERY];
+  Serial.printf("🔋 ADC: %u samples/ch in %u us, %u/%u rejected\n",
+                voltageStats.samples, (unsigned)voltageStats.us,
+                voltageStats.rejected[VOLT_VIN],
+                voltageStats.rejected[VOLT_BATTERY]);
+}
+
+const VoltageStats &getVoltageStats() { return voltageStats; }
+
+bool calibrateVoltage(VoltageChannel ch, float knownVolts) {
+  // average a few rounds so one noisy burst does not set the gain
+  float sum = 0;
+  for (int i = 0; i < 4; i++) {
+    float volts[VOLT_COUNT];
+    measure(volts);
+    sum += volts[ch];
+  }
+  float measured = sum / 4;
+  float gain = knownVolts / measured;
+  if (!(measured > 0.1f) || gain < 0.5f || gain > 2.0f) {
+    Serial.printf("❌ %s reads %.3f V, too far from %.3f V to calibrate\n",
+                  CHANNEL_NAMES[ch], measured, knownVolts);
+    return false;
+  }
+
+  gains[ch] = gain;
+  Preferences prefs;
+  prefs.begin(ADC_NVS_NAMESPACE, false);
+  prefs.putFloat(GAIN_KEYS[ch], gain);
+  prefs.end();
+  Serial.printf("✔ %s gain %.4f saved (read %.3f V, applied %.3f V)\n",
+                CHANNEL_NAMES[ch], gain, measured, knownVolts);
+  return true;
+}
+
+float getVoltageGain(VoltageChannel ch) { return gains[ch]; }
+
+void resetVoltageCalibration() {
+  Preferences prefs;
+  prefs.begin(ADC_NVS_NAMESPACE, false);
+  for (int c = 0; c < VOLT_COUNT; c++) {
+    prefs.remove(GAIN_KEYS[c]);
+    gains[c] = 1.0f;
+  }
+  prefs.end();
+  Serial.println(F("✔ ADC calibration cleared"));
+}
+
+bool SupplySensor::begin() {
+  initVoltage();
+  return true;
+}
+
+bool SupplySensor::read(LogRecord &rec) {
+  float vin, battery;
+  readVoltages(vin, battery);
+  Serial.printf("Voltage 1 (Vin): %.2f V\n", vin);
+  Serial.printf("Voltage 2 (Bat): %.2f V\n", battery);
+  rec.vin = vin;
+  rec.battery = battery;
+  return true;
+}
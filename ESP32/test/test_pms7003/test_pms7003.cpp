@@ -0,0 +1,200 @@
+// PMS7003 frame decoder on the host: pio test -e native
+//
+// The native env does not build src/ for tests (its main() is the wake
+// simulator), so the decoder is compiled in here directly.
+#include "../../src/pms7003.cpp"
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const size_t FRAME_SIZE = 32;
+
+// A data frame carrying pm1/pm2.5/pm10 (atmospheric) and a valid sum
+static size_t makeFrame(uint8_t *out, uint16_t pm1, uint16_t pm25,
+                        uint16_t pm10) {
+  memset(out, 0, FRAME_SIZE);
+  out[0] = 0x42;
+  out[1] = 0x4D;
+  out[3] = 28;
+  uint16_t values[6] = {pm1, pm25, pm10, pm1, pm25, pm10};
+  for (int i = 0; i < 6; i++) {
+    out[4 + 2 * i] = values[i] >> 8;
+    out[5 + 2 * i] = values[i] & 0xFF;
+  }
+  out[28] = 0x91; // version
+  uint16_t sum = 0;
+  for (size_t i = 0; i < FRAME_SIZE - 2; i++)
+    sum += out[i];
+  out[30] = sum >> 8;
+  out[31] = sum & 0xFF;
+  return FRAME_SIZE;
+}
+
+// Feeds bytes and returns how many frames completed
+static int feedAll(PMSParser &p, const uint8_t *data, size_t n) {
+  int done = 0;
+  for (size_t i = 0; i < n; i++)
+    done += p.feed(data[i]);
+  return done;
+}
+
+// What the decoder must accept: header, data length, matching sum
+static bool frameValid(const uint8_t *f) {
+  if (f[0] != 0x42 || f[1] != 0x4D || f[2] != 0 || f[3] != 28)
+    return false;
+  uint16_t sum = 0;
+  for (size_t i = 0; i < FRAME_SIZE - 2; i++)
+    sum += f[i];
+  return sum == ((f[30] << 8) | f[31]);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_decodes_a_frame() {
+  PMSParser p;
+  uint8_t f[FRAME_SIZE];
+  makeFrame(f, 8, 12, 15);
+  TEST_ASSERT_EQUAL(1, feedAll(p, f, sizeof(f)));
+  TEST_ASSERT_EQUAL_UINT16(8, p.frame().pm1Atm);
+  TEST_ASSERT_EQUAL_UINT16(12, p.frame().pm25Atm);
+  TEST_ASSERT_EQUAL_UINT16(15, p.frame().pm10Atm);
+  TEST_ASSERT_EQUAL_UINT8(0x91, p.frame().version);
+  TEST_ASSERT_EQUAL_UINT32(1, p.frames);
+}
+
+static void test_resyncs_after_garbage() {
+  PMSParser p;
+  // stray start bytes and a half header before the real frame
+  uint8_t data[8 + FRAME_SIZE] = {0x00, 0x42, 0x42, 0x13, 0x4D, 0x42, 0x4D, 0xFF};
+  makeFrame(data + 8, 5, 40, 60);
+  TEST_ASSERT_EQUAL(1, feedAll(p, data, sizeof(data)));
+  TEST_ASSERT_EQUAL_UINT16(40, p.frame().pm25Atm);
+  TEST_ASSERT_TRUE(p.skippedBytes > 0);
+}
+
+static void test_rejects_bad_checksum() {
+  PMSParser p;
+  uint8_t f[FRAME_SIZE];
+  makeFrame(f, 8, 12, 15);
+  f[12] ^= 0x01;
+  TEST_ASSERT_EQUAL(0, feedAll(p, f, sizeof(f)));
+  TEST_ASSERT_EQUAL_UINT32(1, p.checksumErrors);
+
+  // the next good frame still decodes
+  makeFrame(f, 1, 2, 3);
+  TEST_ASSERT_EQUAL(1, feedAll(p, f, sizeof(f)));
+  TEST_ASSERT_EQUAL_UINT16(2, p.frame().pm25Atm);
+}
+
+static void test_rejects_bad_length() {
+  PMSParser p;
+  uint8_t f[FRAME_SIZE];
+  makeFrame(f, 8, 12, 15);
+  uint8_t tooLong[] = {0x42, 0x4D, 0x00, 0x40};
+  uint8_t tooShort[] = {0x42, 0x4D, 0x00, 0x02};
+  TEST_ASSERT_EQUAL(0, feedAll(p, tooLong, sizeof(tooLong)));
+  TEST_ASSERT_EQUAL(0, feedAll(p, tooShort, sizeof(tooShort)));
+  TEST_ASSERT_EQUAL_UINT32(2, p.lengthErrors);
+  TEST_ASSERT_EQUAL(1, feedAll(p, f, sizeof(f)));
+}
+
+// A false header inside a real frame must not swallow the frame after it
+static void test_bad_frame_does_not_hide_the_next() {
+  PMSParser p;
+  uint8_t data[6 + FRAME_SIZE];
+  data[0] = 0x42;
+  data[1] = 0x4D;
+  data[2] = 0x00;
+  data[3] = 28; // claims a data frame, then runs into the real one
+  data[4] = 0x11;
+  data[5] = 0x22;
+  makeFrame(data + 6, 3, 4, 5);
+  TEST_ASSERT_EQUAL(1, feedAll(p, data, sizeof(data)));
+  TEST_ASSERT_EQUAL_UINT16(4, p.frame().pm25Atm);
+}
+
+static void test_frame_split_across_reads() {
+  PMSParser p;
+  uint8_t f[FRAME_SIZE];
+  makeFrame(f, 7, 9, 11);
+  for (size_t cut = 1; cut < FRAME_SIZE; cut++) {
+    TEST_ASSERT_EQUAL(0, feedAll(p, f, cut));
+    TEST_ASSERT_EQUAL(1, feedAll(p, f + cut, FRAME_SIZE - cut));
+    TEST_ASSERT_EQUAL_UINT16(9, p.frame().pm25Atm);
+  }
+}
+
+static void test_command_reply_is_not_a_data_frame() {
+  PMSParser p;
+  // reply to the passive-mode command: length 4, two data bytes
+  uint8_t reply[] = {0x42, 0x4D, 0x00, 0x04, 0xE1, 0x00, 0x01, 0x74};
+  TEST_ASSERT_EQUAL(0, feedAll(p, reply, sizeof(reply)));
+  TEST_ASSERT_EQUAL_UINT32(0, p.checksumErrors);
+  TEST_ASSERT_EQUAL(0, p.buffered());
+}
+
+// Random bytes, with start bytes and real frames mixed in so the deeper
+// states are reached. After every byte the decoder holds no more than a
+// frame, and every frame it accepts is exactly the last 32 bytes fed and
+// valid, whatever came before.
+static void test_fuzz() {
+  PMSParser p;
+  srand(12345);
+  uint8_t history[FRAME_SIZE] = {};
+  uint32_t accepted = 0, injected = 0;
+
+  for (uint32_t i = 0; i < 2000000; i++) {
+    uint8_t b;
+    int r = rand() % 16;
+    if (r == 0)
+      b = 0x42;
+    else if (r == 1)
+      b = 0x4D;
+    else if (r == 2)
+      b = 0x00;
+    else
+      b = rand() & 0xFF;
+
+    if (rand() % 4096 == 0) { // now and then a whole valid frame
+      uint8_t f[FRAME_SIZE];
+      makeFrame(f, rand() & 0x3FF, rand() & 0x3FF, rand() & 0x3FF);
+      injected++;
+      for (size_t k = 0; k < FRAME_SIZE; k++) {
+        memmove(history, history + 1, FRAME_SIZE - 1);
+        history[FRAME_SIZE - 1] = f[k];
+        if (p.feed(f[k])) {
+          TEST_ASSERT_TRUE(frameValid(history));
+          accepted++;
+        }
+        TEST_ASSERT_TRUE(p.buffered() <= FRAME_SIZE);
+      }
+      continue;
+    }
+
+    memmove(history, history + 1, FRAME_SIZE - 1);
+    history[FRAME_SIZE - 1] = b;
+    if (p.feed(b)) {
+      TEST_ASSERT_TRUE_MESSAGE(frameValid(history), "accepted a bad frame");
+      accepted++;
+    }
+    TEST_ASSERT_TRUE(p.buffered() <= FRAME_SIZE);
+  }
+  TEST_ASSERT_EQUAL_UINT32(p.frames, accepted);
+  // resync re-scans dropped bytes, so no real frame is lost to garbage
+  TEST_ASSERT_TRUE(accepted >= injected);
+  TEST_ASSERT_TRUE(injected > 0);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_decodes_a_frame);
+  RUN_TEST(test_resyncs_after_garbage);
+  RUN_TEST(test_rejects_bad_checksum);
+  RUN_TEST(test_rejects_bad_length);
+  RUN_TEST(test_bad_frame_does_not_hide_the_next);
+  RUN_TEST(test_frame_split_across_reads);
+  RUN_TEST(test_command_reply_is_not_a_data_frame);
+  RUN_TEST(test_fuzz);
+  return UNITY_END();
+}
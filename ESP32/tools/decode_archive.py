@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+Decode an AQMS compressed archive into CSV: a month file from the card's
+/archive directory (/archive/2025-01.bin), or the single /archive.bin
+written by older firmware. tools/export.py fetches the same data over USB.
+
+The layout mirrors include/archive.h: independent 512-byte blocks, each a
+32-byte header followed by a Gorilla-style bitstream. Block headers carry
+the time range, so --from/--to only decode the blocks that overlap it.
+
+Usage:
+    python decode_archive.py 2025-01.bin > january.csv
+    python decode_archive.py 2025-01.bin --from 2025-01-10 --to "2025-01-12 06:00"
+    python decode_archive.py 2025-01.bin --blocks
+"""
+import argparse
+import csv
+import struct
+import sys
+from datetime import datetime, timezone
+
+from decode_log import NEPAL_TZ, STATUS_BITS, crc16, format_ts
+
+BLOCK_SIZE = 512
+HEADER = struct.Struct("<4sBBHIIhhhhhhHH")
+MAGIC = b"AQAR"
+VERSION = 1
+
+
+class BitReader:
+    def __init__(self, data: bytes):
+        self.value = int.from_bytes(data, "big")
+        self.left = len(data) * 8
+
+    def bits(self, n: int) -> int:
+        if n > self.left:
+            raise ValueError("bitstream ends inside a record")
+        self.left -= n
+        return (self.value >> self.left) & ((1 << n) - 1)
+
+    def signed(self, n: int) -> int:
+        v = self.bits(n)
+        return v - (1 << n) if v & (1 << (n - 1)) else v
+
+
+def read_blocks(f):
+    """Yield (index, header dict, payload) for every block with valid CRCs."""
+    index = 0
+    previous = None
+    while True:
+        raw = f.read(BLOCK_SIZE)
+        if len(raw) != BLOCK_SIZE:
+            break  # end of file or torn trailing block
+        fields = HEADER.unpack(raw[:HEADER.size])
+        magic, version, _, count, ts_min, ts_max = fields[:6]
+        payload = raw[HEADER.size:]
+        ok = (magic == MAGIC and version == VERSION
+              and fields[-1] == crc16(raw[:HEADER.size - 2])
+              and fields[-2] == crc16(payload))
+        # A block is written again if the device resets before saving its
+        # archive cursor; the copy is byte-identical.
+        if not ok:
+            print(f"warning: block {index} is damaged, skipped", file=sys.stderr)
+        elif raw != previous:
+            header = dict(zip(["count", "ts_min", "ts_max", "temp_min", "temp_max",
+                               "hum_min", "hum_max", "pm25_min", "pm25_max"],
+                              fields[3:12]))
+            yield index, header, payload
+        previous = raw
+        index += 1
+
+
+def decode_block(payload: bytes, count: int):
+    """Yield (ts, temp, hum, vin, battery, pm1, pm25, pm10, status)."""
+    r = BitReader(payload)
+    ts = interval = 0
+    floats = [[0, 0, 0] for _ in range(4)]  # bits, leading, trailing
+    pms = [0, 0, 0]
+    status = 0
+
+    for _ in range(count):
+        if r.bits(1) == 0:
+            dod = 0
+        elif r.bits(1) == 0:
+            dod = r.signed(7)
+        elif r.bits(1) == 0:
+            dod = r.signed(9)
+        elif r.bits(1) == 0:
+            dod = r.signed(12)
+        else:
+            dod = None
+        if dod is None:
+            new_ts = r.bits(32)
+            interval = new_ts - ts
+        else:
+            interval += dod
+            new_ts = ts + interval
+        ts = new_ts
+
+        values = []
+        for f in floats:
+            if r.bits(1):
+                if r.bits(1) == 0:
+                    length = 32 - f[1] - f[2]
+                    f[0] ^= r.bits(length) << f[2]
+                else:
+                    f[1] = r.bits(5)
+                    length = r.bits(5) + 1
+                    f[2] = 32 - f[1] - length
+                    f[0] ^= r.bits(length) << f[2]
+            values.append(struct.unpack("<f", struct.pack("<I", f[0]))[0])
+
+        for i in range(3):
+            zigzag = shift = 0
+            while True:
+                group = r.bits(4)
+                zigzag |= (group & 0x7) << shift
+                shift += 3
+                if not group & 0x8:
+                    break
+            pms[i] += (zigzag >> 1) ^ -(zigzag & 1)
+
+        if r.bits(1):
+            status = r.bits(16)
+
+        yield (ts, *values, *pms, status)
+
+
+def parse_time(text, utc):
+    for fmt in ("%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d"):
+        try:
+            t = datetime.strptime(text, fmt)
+        except ValueError:
+            continue
+        return int(t.replace(tzinfo=timezone.utc if utc else NEPAL_TZ).timestamp())
+    raise argparse.ArgumentTypeError(f"bad time {text!r}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an AQMS compressed archive to CSV")
+    parser.add_argument("archive")
+    parser.add_argument("--from", dest="start", help="first time to export (Nepal time unless --utc)")
+    parser.add_argument("--to", dest="end", help="last time to export")
+    parser.add_argument("--utc", action="store_true", help="times in UTC instead of Nepal time")
+    parser.add_argument("--blocks", action="store_true", help="list block headers instead of records")
+    args = parser.parse_args()
+
+    start = parse_time(args.start, args.utc) if args.start else None
+    end = parse_time(args.end, args.utc) if args.end else None
+    ranged = start is not None or end is not None
+
+    def in_range(ts):
+        return ((start is None or ts >= start) and (end is None or ts <= end))
+
+    writer = csv.writer(sys.stdout)
+    if args.blocks:
+        writer.writerow(["block", "count", "from", "to", "temp_min", "temp_max",
+                         "hum_min", "hum_max", "pm25_min", "pm25_max"])
+    else:
+        writer.writerow(["timestamp", "temp", "hum", "pm1", "pm2.5", "pm10",
+                         "battery", "vin"] + STATUS_BITS)
+
+    with open(args.archive, "rb") as f:
+        for index, h, payload in read_blocks(f):
+            # Blocks without a clock reading are only exported in full
+            if ranged and (h["ts_max"] == 0 or (start is not None and h["ts_max"] < start)
+                           or (end is not None and h["ts_min"] > end)):
+                continue
+            if args.blocks:
+                extremes = []
+                for name, scale in (("temp", 100), ("hum", 100), ("pm25", 1)):
+                    lo, hi = h[name + "_min"], h[name + "_max"]
+                    if lo > hi:
+                        extremes += ["", ""]  # no valid reading in the block
+                    else:
+                        extremes += [lo / scale, hi / scale] if scale > 1 else [lo, hi]
+                writer.writerow([index, h["count"], format_ts(h["ts_min"], args.utc),
+                                 format_ts(h["ts_max"], args.utc)] + extremes)
+                continue
+            for ts, temp, hum, vin, battery, pm1, pm25, pm10, status in \
+                    decode_block(payload, h["count"]):
+                if ranged and (ts == 0 or not in_range(ts)):
+                    continue
+                flags = [int(bool(status & (1 << i))) for i in range(len(STATUS_BITS))]
+                writer.writerow([format_ts(ts, args.utc), f"{temp:.2f}", f"{hum:.2f}",
+                                 pm1, pm25, pm10, f"{battery:.2f}", f"{vin:.2f}"] + flags)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Decode an AQMS binary log (/datalog.bin on the SD card) into CSV.
+
+The layout mirrors include/record.h: a 32-byte LogHeader followed by
+32-byte LogRecords, all little-endian. The firmware writes whole 512-byte
+blocks and grows the file ahead in zeros, so the log ends at the first
+all-zero record slot.
+
+Usage:
+    python decode_log.py datalog.bin > datalog.csv
+    python decode_log.py datalog.bin --start 100 --count 48
+"""
+import argparse
+import csv
+import struct
+import sys
+from datetime import datetime, timedelta, timezone
+
+HEADER = struct.Struct("<4sHHIIII6sH")
+RECORD = struct.Struct("<IffffhhhHHH")
+MAGIC = b"AQLG"
+VERSION = 1
+
+STATUS_BITS = ["aht20", "rtc", "pms7003", "wifi", "ntp", "sdcard", "thingspeak", "render", "burst"]
+
+NEPAL_TZ = timezone(timedelta(hours=5, minutes=45))
+
+
+def crc16(data: bytes) -> int:
+    """CRC-16/CCITT-FALSE, same as crc16() in record.cpp."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def read_header(f):
+    raw = f.read(HEADER.size)
+    if len(raw) != HEADER.size:
+        raise ValueError("file too short for a log header")
+    magic, version, record_size, log_id, created, prev_log_id, base, _, crc = HEADER.unpack(raw)
+    if magic != MAGIC:
+        raise ValueError(f"bad magic {magic!r}")
+    if version != VERSION or record_size != RECORD.size:
+        raise ValueError(f"unsupported log version {version} / record size {record_size}")
+    if crc != crc16(raw[:-2]):
+        raise ValueError("header CRC mismatch")
+    # prev_log_id/base: the log this one was compacted from, and how many
+    # of its records were dropped before index 0 here
+    return {"log_id": log_id, "created": created, "prev_log_id": prev_log_id, "base": base}
+
+
+def iter_records(f, start=0, count=None):
+    """Yield (index, fields, crc_ok) by seeking straight to record `start`."""
+    f.seek(HEADER.size + start * RECORD.size)
+    index = start
+    while count is None or index < start + count:
+        raw = f.read(RECORD.size)
+        if len(raw) != RECORD.size:
+            break  # end of file or torn trailing record
+        if not any(raw):
+            break  # unused space after the last record
+        fields = RECORD.unpack(raw)
+        yield index, fields, fields[-1] == crc16(raw[:-2])
+        index += 1
+
+
+def format_ts(ts, utc):
+    if ts == 0:
+        return ""
+    tz = timezone.utc if utc else NEPAL_TZ
+    return datetime.fromtimestamp(ts, tz).strftime("%Y-%m-%d %H:%M:%S")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an AQMS binary log to CSV")
+    parser.add_argument("logfile")
+    parser.add_argument("--start", type=int, default=0, help="first record index")
+    parser.add_argument("--count", type=int, default=None, help="number of records")
+    parser.add_argument("--utc", action="store_true", help="print timestamps in UTC instead of Nepal time")
+    parser.add_argument("--skip-bad", action="store_true", help="drop records that fail the CRC check")
+    args = parser.parse_args()
+
+    writer = csv.writer(sys.stdout)
+    writer.writerow(["index", "timestamp", "temp", "hum", "pm1", "pm2.5", "pm10",
+                     "battery", "vin"] + STATUS_BITS + ["seq", "crc_ok"])
+
+    with open(args.logfile, "rb") as f:
+        read_header(f)
+        bad = 0
+        for index, fields, ok in iter_records(f, args.start, args.count):
+            ts, temp, hum, vin, battery, pm1, pm25, pm10, status, seq, _ = fields
+            if not ok:
+                bad += 1
+                if args.skip_bad:
+                    continue
+            flags = [int(bool(status & (1 << i))) for i in range(len(STATUS_BITS))]
+            writer.writerow([index, format_ts(ts, args.utc), f"{temp:.2f}", f"{hum:.2f}",
+                             pm1, pm25, pm10, f"{battery:.2f}", f"{vin:.2f}"] + flags + [seq, int(ok)])
+
+    if bad:
+        print(f"warning: {bad} record(s) failed the CRC check", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
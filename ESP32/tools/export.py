@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""
+Pull a date range off an AQMS unit over USB serial, without removing the
+SD card, and write it as CSV.
+
+Resets the board, types `export <from> [<to>]` into its console window and
+reads the binary stream described in include/export.h: the monthly archive
+blocks that overlap the range plus the log records not archived yet. Both
+are decoded here (decode_archive.py / decode_log.py), nothing on the device.
+
+Needs pyserial for --port. --input reads a stream saved with --save-stream
+(or the stdout of the native build run with --console "export ...").
+
+Usage:
+    python export.py --port /dev/ttyUSB0 --from 2025-01 > jan-to-now.csv
+    python export.py --port COM5 --from 2025-01-01 --to 2025-01-31 --save-stream jan.bin
+    python export.py --input jan.bin --from 2025-01-01 --to 2025-01-31
+"""
+import argparse
+import csv
+import io
+import struct
+import sys
+import time
+from datetime import datetime, timedelta
+
+from decode_archive import parse_time, read_blocks, decode_block
+from decode_log import HEADER as LOG_HEADER, RECORD, STATUS_BITS, crc16, format_ts
+
+CONSOLE_BAUD = 9600
+EXPORT_BAUD = 921600
+MAGIC = b"AQEX"
+VERSION = 1
+BLOCK_SIZE = 512
+BANNER = "📤 Export".encode()
+FRAME_HEAD = struct.Struct("<cH")
+
+
+def parse_range(start, end, utc):
+    """Inclusive unix range for YYYY-MM[-DD] dates, as the device reads them."""
+    def bounds(text):
+        if len(text) == 7:  # a month
+            first = parse_time(text + "-01", utc)
+            d = datetime.strptime(text + "-01", "%Y-%m-%d") + timedelta(days=32)
+            return first, parse_time(d.strftime("%Y-%m-01"), utc) - 1
+        first = parse_time(text, utc)
+        return first, first + 86399 if len(text) == 10 else first
+
+    lo = bounds(start)[0]
+    hi = bounds(end)[1] if end else None
+    return lo, hi
+
+
+def read_frames(stream):
+    """Yield (type, payload) from a stream positioned after the version byte."""
+    while True:
+        head = stream.read(FRAME_HEAD.size)
+        if len(head) != FRAME_HEAD.size:
+            raise ValueError("stream ended before its end frame")
+        kind, length = FRAME_HEAD.unpack(head)
+        rest = stream.read(length + 2)
+        if len(rest) != length + 2:
+            raise ValueError("stream ended inside a frame")
+        payload, crc = rest[:-2], struct.unpack("<H", rest[-2:])[0]
+        if crc != crc16(head + payload):
+            raise ValueError(f"frame {kind!r} failed its CRC")
+        yield kind, payload
+        if kind == b"E":
+            return
+
+
+def skip_to_stream(stream):
+    """Consume console text up to and including the stream's magic/version."""
+    window = b""
+    seen_banner = False
+    while True:
+        c = stream.read(1)
+        if not c:
+            raise ValueError("no export stream found (is the SD card in?)")
+        window = (window + c)[-64:]
+        if not seen_banner:
+            if BANNER in window and c == b"\n":
+                sys.stderr.write(window[window.index(BANNER):].decode(errors="replace"))
+                seen_banner = True
+                window = b""
+            elif c == b"\n" and b"\xe2\x9d\x8c" in window:  # ❌ from the console
+                raise ValueError(window.decode(errors="replace").strip())
+            continue
+        if window.endswith(MAGIC):
+            version = stream.read(1)
+            if version != bytes([VERSION]):
+                raise ValueError(f"unsupported export version {version!r}")
+            return
+
+
+class Recorder:
+    """File-like wrapper that keeps a copy of everything read (--save-stream)."""
+
+    def __init__(self, stream, copy):
+        self.stream, self.copy = stream, copy
+
+    def read(self, n):
+        data = self.stream.read(n)
+        if self.copy:
+            self.copy.write(data)
+        return data
+
+
+def open_serial(port, command):
+    import serial  # pyserial, only needed for a live unit
+
+    ser = serial.Serial(port, CONSOLE_BAUD, timeout=10)
+    # Auto-reset: EN follows RTS on the usual ESP32 boards
+    ser.dtr = False
+    ser.rts = True
+    time.sleep(0.1)
+    ser.rts = False
+    deadline = time.time() + 15
+    while time.time() < deadline:
+        if b"Sensors ON" in ser.readline():
+            break
+    else:
+        raise SystemExit("no 'Sensors ON' from the unit; wrong port?")
+    # Buffered by the UART until the console window opens
+    ser.write(command.encode() + b"\n")
+
+    class Switching:
+        """Follows the unit to EXPORT_BAUD once its banner line is read."""
+
+        def __init__(self):
+            self.fast = False
+            self.line = b""
+
+        def read(self, n):
+            data = ser.read(n)
+            if not self.fast:
+                self.line = (self.line + data)[-64:]
+                if BANNER in self.line and data.endswith(b"\n"):
+                    ser.baudrate = EXPORT_BAUD
+                    self.fast = True
+            return data
+
+    return ser, Switching()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export a date range from an AQMS unit over serial")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the unit")
+    source.add_argument("--input", help="saved export stream instead of a unit")
+    parser.add_argument("--from", dest="start", required=True, help="YYYY-MM or YYYY-MM-DD")
+    parser.add_argument("--to", dest="end", help="last day or month included (default: now)")
+    parser.add_argument("--utc", action="store_true", help="dates and timestamps in UTC, not Nepal time")
+    parser.add_argument("--save-stream", help="also write the raw stream to this file")
+    args = parser.parse_args()
+
+    start, end = parse_range(args.start, args.end, args.utc)
+    command = f"export {args.start}" + (f" {args.end}" if args.end else "")
+
+    copy = open(args.save_stream, "wb") if args.save_stream else None
+    began = time.time()
+    if args.port:
+        ser, raw = open_serial(args.port, command)
+    else:
+        ser, raw = None, open(args.input, "rb")
+    stream = Recorder(raw, copy)
+
+    blocks = io.BytesIO()
+    records = []
+    log_header = None
+    summary = None
+    received = 0
+    try:
+        skip_to_stream(stream)
+        for kind, payload in read_frames(stream):
+            received += len(payload)
+            if kind == b"A":
+                blocks.write(payload)
+            elif kind == b"H":
+                log_header = payload
+            elif kind == b"L":
+                records.extend(payload[i:i + RECORD.size]
+                               for i in range(0, len(payload), RECORD.size))
+            elif kind == b"E":
+                summary = struct.unpack("<III", payload)
+    except ValueError as exc:
+        raise SystemExit(f"export failed: {exc}")
+    finally:
+        if copy:
+            copy.close()
+        if ser:
+            ser.close()
+        else:
+            raw.close()
+
+    if log_header is not None and len(log_header) != LOG_HEADER.size:
+        raise SystemExit("export failed: bad log header frame")
+
+    def in_range(ts):
+        return ts != 0 and ts >= start and (end is None or ts <= end)
+
+    writer = csv.writer(sys.stdout)
+    writer.writerow(["timestamp", "temp", "hum", "pm1", "pm2.5", "pm10",
+                     "battery", "vin"] + STATUS_BITS)
+    rows = 0
+
+    def emit(ts, temp, hum, vin, battery, pm1, pm25, pm10, status):
+        nonlocal rows
+        flags = [int(bool(status & (1 << i))) for i in range(len(STATUS_BITS))]
+        writer.writerow([format_ts(ts, args.utc), f"{temp:.2f}", f"{hum:.2f}",
+                         pm1, pm25, pm10, f"{battery:.2f}", f"{vin:.2f}"] + flags)
+        rows += 1
+
+    blocks.seek(0)
+    for _, h, payload in read_blocks(blocks):
+        for rec in decode_block(payload, h["count"]):
+            if in_range(rec[0]):
+                emit(*rec)
+    bad = 0
+    for raw_rec in records:
+        fields = RECORD.unpack(raw_rec)
+        if fields[-1] != crc16(raw_rec[:-2]):
+            bad += 1
+            continue
+        if in_range(fields[0]):
+            emit(*fields[:9])
+
+    n_blocks, n_records, device_ms = summary
+    elapsed = time.time() - began
+    print(f"{rows} reading(s) from {n_blocks} archive block(s) and {n_records} "
+          f"log record(s); {received} bytes, device {device_ms} ms"
+          + (f", {elapsed:.1f} s in total" if args.port else ""), file=sys.stderr)
+    if bad:
+        print(f"warning: {bad} log record(s) failed the CRC check", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
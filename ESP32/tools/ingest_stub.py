@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+Minimal stand-in for the ingest backend and ThingSpeak, for the native
+build (`pio run -e native`). Every HTTP host the firmware talks to is
+mapped to this server by the mock HAL.
+
+Handles:
+    POST /api/data        one reading (JSON)
+    POST /api/data/batch  {"records": [...], "meta": {...}}, as JSON or as
+                          application/cbor (decoded with backend/compact.py)
+    GET  /update?...      ThingSpeak single update
+    POST /channels/<id>/bulk_update.json
+                          ThingSpeak bulk update (THINGSPEAK_CHANNEL_ID)
+
+Usage:
+    python ingest_stub.py [--port 8000] [--fail-every N] [--save readings.jsonl]
+                          [--quiet]
+"""
+import argparse
+import json
+import os
+import sys
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..", "backend"))
+import compact  # noqa: E402
+
+stats = {"requests": 0, "records": 0, "bytes": 0, "thingspeak": 0}
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # keep-alive, like the real backend
+
+    def reply(self, code, body=b"{}"):
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        stats["requests"] += 1
+        if self.path.startswith("/update"):
+            stats["thingspeak"] += 1
+            self.reply(200, str(stats["thingspeak"]).encode())
+        else:
+            self.reply(404)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        raw = self.rfile.read(length)
+        stats["requests"] += 1
+        stats["bytes"] += length
+
+        args = self.server.args
+        if args.fail_every and stats["requests"] % args.fail_every == 0:
+            self.reply(503)
+            return
+
+        try:
+            if self.headers.get("Content-Type", "").startswith(compact.CONTENT_TYPE):
+                body = compact.decode_batch(raw)
+            else:
+                body = json.loads(raw)
+        except ValueError as exc:
+            self.reply(422, json.dumps({"detail": str(exc)}).encode())
+            return
+
+        if self.path.endswith("/bulk_update.json"):
+            updates = body.get("updates", [])
+            stats["thingspeak"] += len(updates)
+            if not args.quiet:
+                print(f"{self.path}: {len(updates)} update(s), {length} bytes",
+                      file=sys.stderr)
+            self.reply(202, b'{"success":true}')
+            return
+
+        if self.path.endswith("/batch"):
+            records = body.get("records", [])
+        else:
+            records = [body]
+        stats["records"] += len(records)
+
+        if args.save:
+            with open(args.save, "a") as f:
+                for rec in records:
+                    f.write(json.dumps(rec) + "\n")
+
+        meta = body.get("meta")
+        kind = self.headers.get("Content-Type", "")
+        if not args.quiet:
+            print(f"{self.path}: {len(records)} record(s), {length} bytes {kind}"
+                  + (f", meta={json.dumps(meta)}" if meta else ""), file=sys.stderr)
+        if self.path.endswith("/batch"):
+            self.reply(201, json.dumps({"inserted": len(records)}).encode())
+        else:
+            self.reply(201)
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local ingest stub for the native build")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--fail-every", type=int, default=0, help="answer every Nth request with 503")
+    parser.add_argument("--save", help="append received readings to this JSONL file")
+    parser.add_argument("--quiet", action="store_true",
+                        help="no line per request (fleet runs), only the final totals")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), Handler)
+    server.args = args
+    print(f"ingest stub listening on 127.0.0.1:{args.port}", file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(f"\n{stats['requests']} request(s), {stats['records']} record(s), "
+          f"{stats['bytes']} bytes, {stats['thingspeak']} ThingSpeak update(s)", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
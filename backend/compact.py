@@ -0,0 +1,132 @@
+# compact.py
+"""
+Decoder for the compact batch upload (firmware: ESP32/include/compact.h).
+
+The body is CBOR:  {0: 2, 1: [_ rec, rec, ...], 2: "<meta JSON>"}
+where each rec is [ts, temp, hum, pm1, pm25, pm10, battery, vin, status, seq].
+temp/hum are in 0.01 units and battery/vin in mV. Every field but status
+is a delta from the previous record (starting from 0); null means the
+reading was NaN and does not move the running value. seq is the change in
+the device's 16-bit record counter (wrapping). Version 1 bodies have no seq.
+
+Only the CBOR subset the firmware emits is supported, so no extra
+dependency is needed.
+"""
+import json
+from typing import Any, Dict, List, Tuple
+
+CONTENT_TYPE = "application/cbor"
+VERSION = 2
+VERSIONS = (1, 2)
+
+STATUS_FLAGS = ["aht20", "rtc", "pms7003", "wifi", "ntp", "sdcard", "thingspeak", "render", "burst"]
+# (name, divisor) for the delta-coded fields, in wire order
+FIELDS = [("ts", None), ("temp", 100), ("hum", 100), ("pm1", None), ("pm25", None),
+          ("pm10", None), ("battery", 1000), ("vin", 1000)]
+
+_BREAK = object()
+
+
+class CompactDecodeError(ValueError):
+    pass
+
+
+def _decode(buf: bytes, pos: int) -> Tuple[Any, int]:
+    if pos >= len(buf):
+        raise CompactDecodeError("truncated body")
+    head = buf[pos]
+    pos += 1
+    major, info = head >> 5, head & 0x1F
+
+    if head == 0xFF:
+        return _BREAK, pos
+    if major == 7:
+        simple = {20: False, 21: True, 22: None, 23: None}
+        if info in simple:
+            return simple[info], pos
+        raise CompactDecodeError(f"unsupported simple value {info}")
+
+    if info < 24:
+        arg = info
+    elif info in (24, 25, 26, 27):
+        size = 1 << (info - 24)
+        if pos + size > len(buf):
+            raise CompactDecodeError("truncated body")
+        arg = int.from_bytes(buf[pos:pos + size], "big")
+        pos += size
+    elif info == 31 and major in (4, 5):
+        arg = None  # indefinite length
+    else:
+        raise CompactDecodeError(f"unsupported item 0x{head:02x}")
+
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major in (2, 3):
+        if pos + arg > len(buf):
+            raise CompactDecodeError("truncated string")
+        raw = buf[pos:pos + arg]
+        return (raw if major == 2 else raw.decode("utf-8")), pos + arg
+    if major == 4:
+        items = []
+        while arg is None or len(items) < arg:
+            item, pos = _decode(buf, pos)
+            if item is _BREAK:
+                if arg is None:
+                    break
+                raise CompactDecodeError("unexpected break")
+            items.append(item)
+        return items, pos
+    if major == 5:
+        out = {}
+        while arg is None or len(out) < arg:
+            key, pos = _decode(buf, pos)
+            if key is _BREAK and arg is None:
+                break
+            value, pos = _decode(buf, pos)
+            out[key] = value
+        return out, pos
+    raise CompactDecodeError(f"unsupported major type {major}")
+
+
+def decode_records(rows: List[list], version: int = VERSION) -> List[Dict[str, Any]]:
+    running = [0] * len(FIELDS)
+    seq = 0
+    width = len(FIELDS) + (2 if version >= 2 else 1)
+    records = []
+    for row in rows:
+        if not isinstance(row, list) or len(row) != width:
+            raise CompactDecodeError("bad record shape")
+        rec: Dict[str, Any] = {}
+        for i, (name, divisor) in enumerate(FIELDS):
+            delta = row[i]
+            if delta is None:
+                rec[name] = None
+                continue
+            running[i] += delta
+            rec[name] = running[i] / divisor if divisor else running[i]
+        status = row[len(FIELDS)]
+        if version >= 2:
+            seq = (seq + row[-1]) & 0xFFFF
+            rec["seq"] = seq
+        for bit, flag in enumerate(STATUS_FLAGS):
+            rec[flag] = bool(status & (1 << bit))
+        records.append(rec)
+    return records
+
+
+def decode_batch(body: bytes) -> Dict[str, Any]:
+    """Turn a compact body into the dict shape of schemas.AQMSBatchCreate."""
+    doc, end = _decode(body, 0)
+    if end != len(body):
+        raise CompactDecodeError("trailing bytes after body")
+    if not isinstance(doc, dict) or doc.get(0) not in VERSIONS:
+        raise CompactDecodeError("unsupported compact version")
+    batch: Dict[str, Any] = {"records": decode_records(doc.get(1, []), doc[0])}
+    if 2 in doc:
+        try:
+            batch["meta"] = json.loads(doc[2])
+        except ValueError as exc:
+            raise CompactDecodeError(f"bad meta: {exc}") from exc
+    return batch
@@ -22,6 +22,19 @@ async def create_full_data(data: schemas.AQMSFullDataCreate) -> dict:
     inserted = await coll.find_one({"_id": result.inserted_id})
     return _doc_to_resp(inserted)
 
+async def create_full_data_batch(records: List[schemas.AQMSFullDataCreate],
+                                 meta: Optional[dict] = None) -> int:
+    if not records:
+        return 0
+    coll = database.get_sensor_collection()
+    docs = [r.dict() for r in records]
+    if meta:
+        # Wake telemetry belongs to the reading taken during that wake
+        newest = max(range(len(docs)), key=lambda i: docs[i]["ts"])
+        docs[newest]["meta"] = meta
+    result = await coll.insert_many(docs, ordered=True)
+    return len(result.inserted_ids)
+
 async def get_all_full_data(limit: int = 3000) -> List[dict]:
     coll = database.get_sensor_collection()
     cursor = coll.find().sort("ts", -1).limit(limit)
@@ -30,6 +43,15 @@ async def get_all_full_data(limit: int = 3000) -> List[dict]:
         docs.append(_doc_to_resp(doc))
     return docs
 
+async def get_latest_summary() -> Optional[dict]:
+    """Newest on-device aggregate summary (meta.agg), with its reading's ts."""
+    coll = database.get_sensor_collection()
+    doc = await coll.find_one({"meta.agg": {"$exists": True}},
+                              {"ts": 1, "meta.agg": 1}, sort=[("ts", -1)])
+    if not doc:
+        return None
+    return {"ts": doc["ts"], **doc["meta"]["agg"]}
+
 # ------------------ User CRUD for Authentication/Admin ------------------ #
 
 async def create_user(user: schemas.UserCreate):
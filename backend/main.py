@@ -1,4 +1,4 @@
-from fastapi import FastAPI, Depends, HTTPException, status
+from fastapi import FastAPI, Depends, HTTPException, Request, status
 from fastapi.middleware.cors import CORSMiddleware
 from fastapi.security import OAuth2PasswordRequestForm
 from datetime import timedelta, datetime
@@ -7,7 +7,10 @@ from bson import ObjectId
 
 import schemas
 import crud
+import compact
 import database
+import json
+from pydantic import ValidationError
 import os
 from dotenv import load_dotenv
 
@@ -86,14 +89,15 @@ async def verify_sensor_key(x_api_key: str = Header(...)):
         )
 
 
-@app.post("/api/data", response_model=schemas.AQMSFullDataResponse)
-async def upload_full_data(
-    data: schemas.AQMSFullDataCreate,
-    background_tasks: BackgroundTasks,
-    authorized: bool = Depends(verify_sensor_key)
-):
-    response = await crud.create_full_data(data)
+# Flags that only say how a reading left the device. With store-and-forward
+# most readings are taken on offline wakes (wifi False), and with ThingSpeak
+# bulk updates the thingspeak flag is not the upload result, so the batch
+# route does not alert on them.
+LINK_FIELDS = ("wifi", "thingspeak")
 
+
+def queue_device_alerts(data: schemas.AQMSFullDataCreate, background_tasks: BackgroundTasks,
+                        skip=()):
     alert_messages = []
 
     # Check battery voltage
@@ -101,11 +105,22 @@ async def upload_full_data(
     #     alert_messages.append(f"Battery voltage is low ({data.battery}V)")
 
 
-    # Check device boolean flags; if False, add alerts
-    device_fields = ["aht20", "rtc", "pms7003", "wifi", "ntp", "sdcard", "thingspeak"]
-    for field in device_fields:
-        if not getattr(data, field):
-            alert_messages.append(f"Device {field} status is FALSE")
+    # Check device boolean flags; if False, add alerts.
+    # "ntp" means the reading's time is trusted: synced this wake, or the
+    # DS3231 drift model still vouches for it. Most wakes skip NTP, so a
+    # False here is a clock that really needs a sync.
+    device_fields = {
+        "aht20": "aht20 status is FALSE",
+        "rtc": "rtc status is FALSE",
+        "pms7003": "pms7003 status is FALSE",
+        "wifi": "wifi status is FALSE",
+        "ntp": "clock is not trusted (NTP overdue or failing)",
+        "sdcard": "sdcard status is FALSE",
+        "thingspeak": "thingspeak status is FALSE",
+    }
+    for field, message in device_fields.items():
+        if field not in skip and not getattr(data, field):
+            alert_messages.append(f"Device {message}")
 
     # If any alerts, prepare message with Nepali time
     if alert_messages:
@@ -114,14 +129,83 @@ async def upload_full_data(
         print(f"Alert msg: {alert_msg}")
         background_tasks.add_task(send_whatsapp_alert, alert_msg)
 
+
+@app.post("/api/data", response_model=schemas.AQMSFullDataResponse)
+async def upload_full_data(
+    data: schemas.AQMSFullDataCreate,
+    background_tasks: BackgroundTasks,
+    authorized: bool = Depends(verify_sensor_key)
+):
+    response = await crud.create_full_data(data)
+    queue_device_alerts(data, background_tasks)
     return response
 
 
+MAX_BATCH_RECORDS = 500
+
+async def parse_batch_body(request: Request) -> schemas.AQMSBatchCreate:
+    """
+    JSON by default; application/cbor is the firmware's compact delta-coded
+    encoding (see compact.py).
+    """
+    content_type = request.headers.get("content-type", "")
+    body = await request.body()
+    try:
+        if content_type.startswith(compact.CONTENT_TYPE):
+            payload = compact.decode_batch(body)
+        else:
+            payload = json.loads(body)
+        return schemas.AQMSBatchCreate.model_validate(payload)
+    except ValidationError as exc:
+        raise HTTPException(
+            status_code=status.HTTP_422_UNPROCESSABLE_ENTITY,
+            detail=exc.errors()
+        )
+    except ValueError as exc:
+        raise HTTPException(
+            status_code=status.HTTP_422_UNPROCESSABLE_ENTITY,
+            detail=f"Malformed batch body: {exc}"
+        )
+
+
+@app.post("/api/data/batch", response_model=schemas.AQMSBatchResponse)
+async def upload_full_data_batch(
+    background_tasks: BackgroundTasks,
+    authorized: bool = Depends(verify_sensor_key),
+    batch: schemas.AQMSBatchCreate = Depends(parse_batch_body)
+):
+    """
+    Bulk ingest for backlog replay: many readings in one request.
+    Only the batch carrying meta holds the reading of the uploading wake,
+    so only its newest reading is checked for alerts; the backlog sent
+    before it is history.
+    """
+    if len(batch.records) > MAX_BATCH_RECORDS:
+        raise HTTPException(
+            status_code=status.HTTP_413_REQUEST_ENTITY_TOO_LARGE,
+            detail=f"At most {MAX_BATCH_RECORDS} records per batch"
+        )
+
+    inserted = await crud.create_full_data_batch(batch.records, batch.meta)
+    if batch.records and batch.meta is not None:
+        latest = max(batch.records, key=lambda r: r.ts)
+        queue_device_alerts(latest, background_tasks, skip=LINK_FIELDS)
+    return {"inserted": inserted}
+
+
 @app.get("/api/data", response_model=list[schemas.AQMSPublicDataResponse])
 async def get_full_data():
     """Frontend GET endpoint to retrieve all sensor data"""
     return await crud.get_all_full_data()
 
+@app.get("/api/summary")
+async def get_summary():
+    """Hourly/daily PM aggregates and 24 h AQI computed by the device"""
+    summary = await crud.get_latest_summary()
+    if summary is None:
+        raise HTTPException(status_code=404, detail="No summary uploaded yet")
+    return summary
+
 # ==================== BASIC ROUTES ====================
 @app.get("/")
 async def root():
@@ -1,17 +1,17 @@
 # schemas.py
 from pydantic import BaseModel, EmailStr
 from datetime import datetime
-from typing import Optional
+from typing import Any, Dict, List, Optional
 
 class AQMSFullDataBase(BaseModel):
     ts: int
     pm1: float
     pm25: float
     pm10: float
-    temp: float
-    hum: float
-    battery: float
-    vin: float
+    temp: Optional[float] = None     # null when the AHT20 read failed
+    hum: Optional[float] = None
+    battery: Optional[float] = None
+    vin: Optional[float] = None
 
     aht20: bool
     rtc: bool
@@ -20,14 +20,26 @@ class AQMSFullDataBase(BaseModel):
     ntp: bool
     sdcard: bool
     thingspeak: bool
+    burst: bool = False  # dense sample taken during a pollution event
+    seq: Optional[int] = None  # device record counter (16-bit, wraps); gaps are lost readings
+
+    # Per-wake device telemetry (e.g. wifi_ms), sent with the newest reading
+    meta: Optional[Dict[str, Any]] = None
 
 class AQMSFullDataCreate(AQMSFullDataBase):
     pass
 
+class AQMSBatchCreate(BaseModel):
+    records: List[AQMSFullDataCreate]   # Backlog replay, oldest first
+    meta: Optional[Dict[str, Any]] = None
+
+class AQMSBatchResponse(BaseModel):
+    inserted: int
+
 class AQMSPublicDataResponse(BaseModel):
     ts: int          # Timestamp
-    temp: float      # Temperature
-    hum: float       # Humidity
+    temp: Optional[float] = None      # Temperature
+    hum: Optional[float] = None       # Humidity
     pm1: float        # PM 1.0
     pm25: float       # PM 2.5
     pm10: float        # PM 10